@@ -5,6 +5,7 @@
 #include <sys/types.h>    
 #include <sys/socket.h>
 #include <errno.h>
+#include <fcntl.h>
 #include <unistd.h>
 
 
@@ -23,6 +24,8 @@ Acceptor::Acceptor(EventLoop *loop, const InetAddress &listenAddr, bool reusepor
     , acceptSocket_(createNonblocking()) //创建socket套接字
     , acceptChannel_(loop, acceptSocket_.fd()) //fd就是上面写的方法返回的sockfd，channel和poller都是通过请求本线程的loop和poller通信
     , listenning_(false)
+    , acceptBatch_(kDefaultAcceptBatch)
+    , idleFd_(::open("/dev/null", O_RDONLY | O_CLOEXEC))
 {
     acceptSocket_.setReuseAddr(true);//地址重用
     acceptSocket_.setReusePort(true);//端口重用
@@ -36,6 +39,10 @@ Acceptor::~Acceptor()
 {
     acceptChannel_.disableAll();
     acceptChannel_.remove();
+    if (idleFd_ >= 0)
+    {
+        ::close(idleFd_);
+    }
 }
 
 
@@ -48,28 +55,56 @@ void Acceptor::listen()
 }
 
 //listenfd有事件发生了，就是有新用户连接了
+//一次最多accept acceptBatch_个，accept到EAGAIN说明backlog已经空了
 void Acceptor::handleRead()
 {
-    InetAddress peerAddr;
-    int connfd = acceptSocket_.accept(&peerAddr);
-    if (connfd >= 0)
+    const int batch = acceptBatch_.load(std::memory_order_relaxed);
+    for (int i = 0; i < batch; ++i)
     {
-        if (newConnectionCallback_)
-        {   
-            // 有新的连接之后去执行newConnectionCallback_回调函数，该回调函数由TcpServer设置
-            newConnectionCallback_(connfd, peerAddr);//轮询找到subLoop，唤醒，分发当前的新客户端的Channel
+        InetAddress peerAddr;
+        int connfd = acceptSocket_.accept(&peerAddr);
+        if (connfd >= 0)
+        {
+            if (newConnectionCallback_)
+            {   
+                // 有新的连接之后去执行newConnectionCallback_回调函数，该回调函数由TcpServer设置
+                newConnectionCallback_(connfd, peerAddr);//轮询找到subLoop，唤醒，分发当前的新客户端的Channel
+            }
+            else//客户端没有办法去服务 
+            {
+                ::close(connfd);
+            }
+            continue;
+        }
+
+        int savedErrno = errno;
+        if (savedErrno == EAGAIN || savedErrno == EWOULDBLOCK)
+        {
+            break;
         }
-        else//客户端没有办法去服务 
+        if (savedErrno == EINTR || savedErrno == ECONNABORTED) // 对端在accept之前就断开了，接着accept下一个
         {
-            ::close(connfd);
+            continue;
         }
-    }
-    else
-    {
-        LOG_ERROR("%s:%s:%d accept error:%d \n", __FILE__, __FUNCTION__, __LINE__, errno);
-        if (errno == EMFILE)
+        if (savedErrno == EMFILE || savedErrno == ENFILE)
         {
-            LOG_ERROR("%s:%s:%d sockfd reached limit! \n", __FILE__, __FUNCTION__, __LINE__);
+            // fd用完了，连接一直留在backlog里，listenfd会一直可读，mainloop就会空转
+            // 用预留的fd腾出一个位置把这个连接accept出来马上关掉，对端收到的是正常的FIN，而不是一直连不上
+            LOG_ERROR("%s:%s:%d sockfd reached limit, shed one connection \n", __FILE__, __FUNCTION__, __LINE__);
+            if (idleFd_ >= 0)
+            {
+                ::close(idleFd_);
+                idleFd_ = ::accept(acceptSocket_.fd(), nullptr, nullptr);
+                if (idleFd_ >= 0)
+                {
+                    ::close(idleFd_);
+                }
+                idleFd_ = ::open("/dev/null", O_RDONLY | O_CLOEXEC);
+                continue;
+            }
+            break;
         }
+        LOG_ERROR("%s:%s:%d accept error:%d \n", __FILE__, __FUNCTION__, __LINE__, savedErrno);
+        break;
     }
 }
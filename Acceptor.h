@@ -4,6 +4,7 @@
 #include "Socket.h"
 #include "Channel.h"
 
+#include <atomic>
 #include <functional>
 
 class EventLoop;
@@ -20,6 +21,12 @@ public:
     bool listenning() const  { return listenning_; }
     void listen();
 
+    // 一次可读通知最多accept多少个连接，连接风暴时不用每个连接都回一趟epoll_wait
+    // 可以在其他线程里调用（TcpServer::setAcceptBatch在start之后调用时）
+    void setAcceptBatch(int batch) { acceptBatch_.store(batch > 0 ? batch : 1, std::memory_order_relaxed); }
+
+    static const int kDefaultAcceptBatch = 16;
+
 private:
     void handleRead();
 
@@ -29,5 +36,7 @@ private:
     
     NewConnectionCallback newConnectionCallback_;
     bool listenning_;
+    std::atomic_int acceptBatch_;
+    int idleFd_; // 预留的空闲fd，fd用完（EMFILE）时关掉它腾出一个位置，accept以后马上关闭连接，再把它占回来
 
 };
\ No newline at end of file
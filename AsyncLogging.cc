@@ -0,0 +1,208 @@
+#include "AsyncLogging.h"
+#include "LogFile.h"
+
+#include <algorithm>
+#include <chrono>
+#include <stdio.h>
+#include <time.h>
+#include <sys/uio.h>
+
+std::atomic<uint64_t> AsyncLogging::numCreated_(0);
+
+namespace
+{
+    // 当前线程在哪个AsyncLogging实例里登记过缓冲区
+    thread_local uint64_t t_ownerId = 0;
+    thread_local std::shared_ptr<void> t_threadBuffer;
+}
+
+AsyncLogging::AsyncLogging(const std::string &basename, off_t rollSize, int flushInterval)
+    : flushInterval_(flushInterval)
+    , basename_(basename)
+    , rollSize_(rollSize)
+    , id_(++numCreated_)
+    , running_(false)
+    , thread_(std::bind(&AsyncLogging::threadFunc, this), "Logging")
+    , flushRequested_(0)
+    , flushCompleted_(0)
+{
+}
+
+AsyncLogging::~AsyncLogging()
+{
+    if (running_)
+    {
+        stop();
+    }
+}
+
+void AsyncLogging::start()
+{
+    running_ = true;
+    thread_.start();
+}
+
+void AsyncLogging::stop()
+{
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        running_ = false;
+        cond_.notify_one();
+    }
+    thread_.join();
+}
+
+// 第一次在某个线程里写日志时，给这个线程分配缓冲区并登记，后端才能找到它
+AsyncLogging::ThreadBuffer* AsyncLogging::threadBuffer()
+{
+    if (t_ownerId != id_ || !t_threadBuffer)
+    {
+        ThreadBufferPtr tb(new ThreadBuffer);
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            threadBuffers_.push_back(tb);
+        }
+        t_threadBuffer = tb;
+        t_ownerId = id_;
+    }
+    return static_cast<ThreadBuffer*>(t_threadBuffer.get());
+}
+
+// 锁的顺序：ThreadBuffer::mutex => mutex_，后端从不同时持有两把锁
+AsyncLogging::BufferPtr AsyncLogging::takeBuffer()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (!freeBuffers_.empty())
+    {
+        BufferPtr buffer = std::move(freeBuffers_.back());
+        freeBuffers_.pop_back();
+        return buffer;
+    }
+    lock.unlock();
+    return BufferPtr(new LogBuffer);
+}
+
+void AsyncLogging::append(const char *logline, size_t len)
+{
+    ThreadBuffer *tb = threadBuffer();
+    std::unique_lock<std::mutex> lock(tb->mutex);
+    if (!tb->current)
+    {
+        tb->current = takeBuffer();
+    }
+
+    if (tb->current->avail() <= len) // 当前缓冲区写满了，交给后端，换一块新的
+    {
+        {
+            std::unique_lock<std::mutex> guard(mutex_);
+            buffers_.push_back(std::move(tb->current));
+            cond_.notify_one();
+        }
+        tb->current = takeBuffer();
+    }
+    if (len < tb->current->avail())
+    {
+        tb->current->append(logline, len);
+    }
+}
+
+void AsyncLogging::flush()
+{
+    if (!running_)
+    {
+        return;
+    }
+    std::unique_lock<std::mutex> lock(mutex_);
+    uint64_t seq = ++flushRequested_;
+    cond_.notify_one();
+    // 最多等一个flushInterval，后端线程卡住了也不能让调用者（比如FATAL）一直阻塞
+    flushed_.wait_for(lock, std::chrono::seconds(flushInterval_ + 1),
+        [this, seq] { return flushCompleted_ >= seq || !running_; });
+}
+
+// 后端线程：定时或者被前端唤醒，把所有缓冲区换出来写到文件里
+void AsyncLogging::threadFunc()
+{
+    LogFile output(basename_, rollSize_);
+    BufferVector buffersToWrite;
+    std::vector<ThreadBufferPtr> threads;
+    std::vector<struct iovec> iov;
+
+    bool exiting = false;
+    while (!exiting)
+    {
+        uint64_t flushSeq = 0;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            if (buffers_.empty() && flushRequested_ == flushCompleted_ && running_)
+            {
+                cond_.wait_for(lock, std::chrono::seconds(flushInterval_));
+            }
+            exiting = !running_;
+            flushSeq = flushRequested_;
+            buffersToWrite.swap(buffers_);
+            threads = threadBuffers_;
+        }
+
+        // 再把每个线程还没写满的缓冲区换出来，这样每隔flushInterval秒日志一定会落盘
+        std::vector<bool> dead(threads.size(), false);
+        for (size_t i = 0; i < threads.size(); ++i)
+        {
+            // 引用计数只剩registry和threads这两份，说明线程已经退出了，取完数据就可以注销
+            dead[i] = threads[i].use_count() == 2;
+            std::unique_lock<std::mutex> lock(threads[i]->mutex);
+            if (threads[i]->current && threads[i]->current->length() > 0)
+            {
+                buffersToWrite.push_back(std::move(threads[i]->current));
+            }
+        }
+
+        if (buffersToWrite.size() > kMaxBuffersToWrite)
+        {
+            char buf[256];
+            time_t now = ::time(NULL);
+            int n = snprintf(buf, sizeof buf, "Dropped log messages at %ld, %zu larger buffers\n",
+                static_cast<long>(now), buffersToWrite.size() - 2);
+            fputs(buf, stderr);
+            output.append(buf, n);
+            buffersToWrite.resize(2);
+        }
+
+        iov.clear();
+        for (const BufferPtr &buffer : buffersToWrite)
+        {
+            struct iovec vec;
+            vec.iov_base = const_cast<char*>(buffer->data());
+            vec.iov_len = buffer->length();
+            iov.push_back(vec);
+        }
+        if (!iov.empty())
+        {
+            output.appendv(&*iov.begin(), static_cast<int>(iov.size()));
+        }
+
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            for (BufferPtr &buffer : buffersToWrite)
+            {
+                if (freeBuffers_.size() >= kMaxFreeBuffers)
+                {
+                    break;
+                }
+                buffer->reset();
+                freeBuffers_.push_back(std::move(buffer));
+            }
+            for (size_t i = 0; i < threads.size(); ++i)
+            {
+                if (dead[i])
+                {
+                    threadBuffers_.erase(std::find(threadBuffers_.begin(), threadBuffers_.end(), threads[i]));
+                }
+            }
+            flushCompleted_ = flushSeq;
+            flushed_.notify_all();
+        }
+        buffersToWrite.clear();
+        threads.clear();
+    }
+}
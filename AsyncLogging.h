@@ -0,0 +1,96 @@
+#pragma once
+
+#include "noncopyable.h"
+#include "Thread.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <string.h>
+#include <sys/types.h>
+
+/**
+ * 异步日志后端
+ * 前端：每个写日志的线程有自己的缓冲区，append只锁自己线程的那把锁（正常情况下没人竞争），不做任何IO
+ * 后端：一个专门的线程，缓冲区写满或者每隔flushInterval秒，把所有线程的缓冲区换出来，批量writev到LogFile
+ *
+ * 用法：
+ *     AsyncLogging log("server", 500 * 1000 * 1000);
+ *     log.start();
+ *     Logger::instance().setOutput(std::bind(&AsyncLogging::append, &log, _1, _2));
+ *     Logger::instance().setFlush(std::bind(&AsyncLogging::flush, &log));
+ */
+class AsyncLogging : noncopyable
+{
+public:
+    AsyncLogging(const std::string &basename, off_t rollSize, int flushInterval = 3);
+    ~AsyncLogging();
+
+    // 前端接口，任何线程都可以调用
+    void append(const char *logline, size_t len);
+    // 阻塞到后端把目前为止append的日志都写进文件为止
+    void flush();
+
+    void start();
+    void stop();
+
+private:
+    // 定长缓冲区，写满了就整个交给后端
+    class LogBuffer : noncopyable
+    {
+    public:
+        LogBuffer() : cur_(data_) {}
+
+        void append(const char *buf, size_t len) { memcpy(cur_, buf, len); cur_ += len; }
+        const char* data() const { return data_; }
+        size_t length() const { return cur_ - data_; }
+        size_t avail() const { return end() - cur_; }
+        void reset() { cur_ = data_; }
+
+    private:
+        const char* end() const { return data_ + sizeof data_; }
+
+        char data_[1024 * 1024];
+        char *cur_;
+    };
+
+    using BufferPtr = std::unique_ptr<LogBuffer>;
+    using BufferVector = std::vector<BufferPtr>;
+
+    // 每个线程一份的前端缓冲区，后端换出current时才会和前端竞争mutex
+    struct ThreadBuffer
+    {
+        std::mutex mutex;
+        BufferPtr current;
+    };
+    using ThreadBufferPtr = std::shared_ptr<ThreadBuffer>;
+
+    ThreadBuffer* threadBuffer();
+    BufferPtr takeBuffer();
+    void threadFunc();
+
+    static const size_t kMaxBuffersToWrite = 25; // 后端积压超过这么多缓冲区就丢掉，防止日志把内存撑爆
+    static const size_t kMaxFreeBuffers = 16;
+
+    const int flushInterval_;
+    const std::string basename_;
+    const off_t rollSize_;
+    const uint64_t id_; // 区分不同的AsyncLogging实例，线程局部缓冲区按它判断是不是自己的
+
+    std::atomic_bool running_;
+    Thread thread_;
+
+    std::mutex mutex_; // 保护下面所有成员
+    std::condition_variable cond_;     // 通知后端：有写满的缓冲区/有人要flush/要退出了
+    std::condition_variable flushed_;  // 通知flush()：后端写完了一轮
+    BufferVector buffers_;     // 前端写满、等待后端写出的缓冲区
+    BufferVector freeBuffers_; // 后端写完还回来的空缓冲区
+    std::vector<ThreadBufferPtr> threadBuffers_; // 所有登记过的线程缓冲区
+    uint64_t flushRequested_;
+    uint64_t flushCompleted_;
+
+    static std::atomic<uint64_t> numCreated_;
+};
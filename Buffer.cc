@@ -1,16 +1,40 @@
 #include "Buffer.h"
+#include "BufferPool.h"
 
 #include <errno.h>
 #include <sys/uio.h>
 #include <unistd.h>
 
+#include <memory>
+
+namespace
+{
+    // 每个线程一块，同一个线程里所有连接的readFd共用；只在要求的大小变大时重新分配，也不清零
+    // 原来是每次调用都在栈上 char extrabuf[65536] = {0}，每个读事件都要先memset 64K
+    thread_local std::unique_ptr<char[]> t_extraBuf;
+    thread_local size_t t_extraBufSize = 0;
+
+    char* extraBuffer(size_t size)
+    {
+        if (t_extraBufSize < size)
+        {
+            t_extraBuf.reset(new char[size]);
+            t_extraBufSize = size;
+        }
+        return t_extraBuf.get();
+    }
+}
+
+char Buffer::emptyStorage_[Buffer::kCheapPrepend];
+
 /*
     从fd上读取数据  Poller工作在LT模式
     Buffer缓冲区是有大小的！ 但是从fd上读数据的时候，却不知道TCP数据最终的大小
 */ 
-ssize_t Buffer::readFd(int fd, int* saveErrno)
+ssize_t Buffer::readFd(int fd, int* saveErrno, size_t extraBufSize)
 {
-    char extrabuf[65536] = {0}; // 这是栈上的内存空间，一次最多读64K
+    reserveForRead(extraBufSize);
+    char *extrabuf = extraBuffer(extraBufSize); // 本线程复用的内存空间，一次最多多读extraBufSize字节
 
     struct iovec vec[2]; // iovec结构体有两个成员iov_base和iov_len
     const size_t writable = writableBytes();//这是Buffer底层缓冲区 剩余 的可写空间大小: buffer_.size() - writerIndex_
@@ -21,9 +45,9 @@ ssize_t Buffer::readFd(int fd, int* saveErrno)
 
     // 第二块缓冲区(如果第一块不够，就需要往这里面填数据)
     vec[1].iov_base = extrabuf;
-    vec[1].iov_len = sizeof extrabuf;
+    vec[1].iov_len = extraBufSize;
 
-    const int iovcnt = (writable < sizeof extrabuf) ? 2 : 1; // writable小于 65536/1024 = 64，iovcnt为2
+    const int iovcnt = (writable < extraBufSize) ? 2 : 1; // Buffer剩余空间比extrabuf还大时就不用它了
     const ssize_t n = ::readv(fd, vec, iovcnt); // extern ssize_t readv (int __fd, const struct iovec *__iovec, int __count) __wur;
     if (n < 0) // 出错
     {
@@ -35,13 +59,51 @@ ssize_t Buffer::readFd(int fd, int* saveErrno)
     }
     else // extrabuf里面也写入了数据，即vec[0]不够用
     {
-        writerIndex_ = buffer_.size(); // writableBytes写满了，所以writerIndex_等于buffer_.size()，相当于到Buffer的末尾了
+        writerIndex_ += writable; // writableBytes写满了，相当于到Buffer的末尾了；还没分配时writable是0，数据全在extrabuf里
         append(extrabuf, n-writable); // 从writeIndex_开始写 n-writable 大小的数据，writable大小的数据在Buffer中写了，即vec[0]
     }
     return n;
 }
 
 
+/*
+    Poller工作在ET模式时，一次通知必须把fd读空，否则剩下的数据不会再有通知
+    但是一直读下去，一个发送很快的连接就会饿死同一个loop上的其他连接，所以用maxBytes限制一次最多读多少
+*/
+ssize_t Buffer::readFdAll(int fd, size_t maxBytes, int* saveErrno, bool* peerClosed, size_t extraBufSize)
+{
+    size_t total = 0;
+    *peerClosed = false;
+    while (total < maxBytes)
+    {
+        reserveForRead(extraBufSize);
+        const size_t writable = writableBytes();
+        const size_t capacity = writable < extraBufSize ? writable + extraBufSize : writable; // 这一次readv最多能读的字节数，和readFd里的iovcnt对应
+        const ssize_t n = readFd(fd, saveErrno, extraBufSize);
+        if (n > 0)
+        {
+            total += n;
+            if (static_cast<size_t>(n) < capacity) // 没读满，说明内核缓冲区已经空了，省一次返回EAGAIN的readv
+            {
+                break;
+            }
+        }
+        else if (n == 0)
+        {
+            *peerClosed = true;
+            break;
+        }
+        else
+        {
+            if (total == 0)
+            {
+                return -1;
+            }
+            break;
+        }
+    }
+    return total;
+}
 
 ssize_t Buffer::writeFd(int fd, int* saveErrno)
 {
@@ -51,4 +113,22 @@ ssize_t Buffer::writeFd(int fd, int* saveErrno)
         *saveErrno = errno;
     }
     return n;
-}
\ No newline at end of file
+}
+
+void Buffer::acquireFrom(BufferPool *pool)
+{
+    if (buffer_.empty())
+    {
+        buffer_ = pool->acquire();
+        readerIndex_ = writerIndex_ = kCheapPrepend;
+    }
+}
+
+void Buffer::releaseTo(BufferPool *pool)
+{
+    if (!buffer_.empty() && readableBytes() == 0)
+    {
+        pool->release(std::move(buffer_));
+        readerIndex_ = writerIndex_ = kCheapPrepend;
+    }
+}
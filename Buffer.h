@@ -4,21 +4,34 @@
 #include <string>
 #include <algorithm>
 
+class BufferPool;
+
 // 网络库底层的缓冲区类型定义
 class Buffer
 {
 public:
     static const size_t kCheapPrepend = 8;//头部字节大小 记录数据包的长度 
     static const size_t kInitialSize = 1024;//缓冲区的大小
+    static const size_t kDefaultExtraBufSize = 65536;//readFd时接住溢出数据的线程局部缓冲区的默认大小
 
+    // 构造时不分配内存，第一次写入数据时才开辟kCheapPrepend + initialSize（不够就按需要的大小）
+    // 大部分时间没有数据的连接（长连接推送之类）不用每个都先占着1K
     explicit Buffer(size_t initialSize = kInitialSize)
-        : buffer_(kCheapPrepend + kInitialSize)//开辟的大小
+        : initialSize_(initialSize)
         , readerIndex_(kCheapPrepend)
         , writerIndex_(kCheapPrepend)
     {}
 
     //  prependableBytes    |       readableBytes         |       writableBytes
     //     <=         readerIndex_       <=         writerIndex_     <=    buffer_.size()
+    void swap(Buffer &rhs)
+    {
+        std::swap(initialSize_, rhs.initialSize_);
+        buffer_.swap(rhs.buffer_);
+        std::swap(readerIndex_, rhs.readerIndex_);
+        std::swap(writerIndex_, rhs.writerIndex_);
+    }
+
     //可读的数据长度 
     size_t readableBytes() const 
     {
@@ -28,7 +41,7 @@ public:
     //可写的缓冲区长度 
     size_t writableBytes() const 
     {
-        return buffer_.size() - writerIndex_;
+        return buffer_.empty() ? 0 : buffer_.size() - writerIndex_; // 还没分配时writerIndex_已经是kCheapPrepend了
     }
 
     //返回头部的空间的大小 
@@ -101,21 +114,42 @@ public:
         return begin() + writerIndex_;
     }
 
+    // 直接往beginWrite()写了len字节以后调用
+    void hasWritten(size_t len)
+    {
+        writerIndex_ += len;
+    }
+
     // TcpConnection.cc中的handleRead和handleWrite中使用
-    // 从fd上读取数据 
-    ssize_t readFd(int fd, int* saveErrno);
+    // 从fd上读取数据，一次最多读 writableBytes() + extraBufSize 字节
+    // Buffer装不下的部分先读进本线程的一块复用的缓冲区（extraBufSize字节），再append进来
+    ssize_t readFd(int fd, int* saveErrno, size_t extraBufSize = kDefaultExtraBufSize);
+    // 边缘触发模式用：反复readFd，直到fd被读空（EAGAIN或者一次没读满）、读到EOF、出错，或者总共读了maxBytes
+    // 返回读到的总字节数，一个字节都没读到又出错时返回-1；读到EOF时*peerClosed为true
+    // 返回值 >= maxBytes 说明是被maxBytes截住的，fd里可能还有数据
+    ssize_t readFdAll(int fd, size_t maxBytes, int* saveErrno, bool* peerClosed,
+                      size_t extraBufSize = kDefaultExtraBufSize);
     // 通过fd发送数据
     ssize_t writeFd(int fd, int* saveErrno);
 
+    // 还没分配内存时从pool取一块，已经有内存就什么都不做
+    void acquireFrom(BufferPool *pool);
+    // 没有可读数据时把内存还给pool（扩容过的大块由pool直接释放），回到刚构造时没分配的状态
+    void releaseTo(BufferPool *pool);
+    // 底层实际占用的字节数，没分配时为0
+    size_t capacity() const { return buffer_.capacity(); }
+
 private:
+    // 还没分配时buffer_.data()可能是nullptr，nullptr + readerIndex_是未定义行为，这时返回一块静态的空数组
+    // 没分配时readerIndex_ == writerIndex_ == kCheapPrepend，peek()/beginWrite()正好指向它的末尾，不会被读写
     char* begin()
     {   
         // it.operator*().operator&()  先 * 获取迭代器指向的元素，然后再 & 获取元素的地址，也就是数组的起始地址
-        return &*buffer_.begin();
+        return buffer_.empty() ? emptyStorage_ : buffer_.data();
     }
     const char* begin() const
     {
-        return &*buffer_.begin();
+        return buffer_.empty() ? emptyStorage_ : buffer_.data();
     }
 
     // 扩容函数
@@ -130,7 +164,11 @@ private:
         
         kCheapPrepend  |  reader  |  writer  | 这些空间加起来都没有len + kCheapPrepend大
         */
-       if (writableBytes() + prependableBytes() < len + kCheapPrepend)
+       if (buffer_.empty()) // 第一次写入，这时才真正分配
+       {
+            buffer_.resize(kCheapPrepend + std::max(initialSize_, len));
+       }
+       else if (writableBytes() + prependableBytes() < len + kCheapPrepend)
        {
             buffer_.resize(writerIndex_ + len);
        }
@@ -144,6 +182,18 @@ private:
             writerIndex_ = readerIndex_ + readable;
        }
     }
+    // readFd之前调用：Buffer还没分配、extraBufSize又是0时，readv的两块长度都是0，返回0会被当成对端关闭，先分配出空间
+    void reserveForRead(size_t extraBufSize)
+    {
+        if (extraBufSize == 0 && writableBytes() == 0)
+        {
+            ensureWriteableBytes(1);
+        }
+    }
+
+    static char emptyStorage_[kCheapPrepend];
+
+    size_t initialSize_;
     std::vector<char> buffer_;
     size_t readerIndex_;
     size_t writerIndex_;
@@ -0,0 +1,29 @@
+#include "BufferPool.h"
+
+#include <utility>
+
+BufferPool::BufferPool(size_t bufferSize, size_t maxFree)
+    : bufferSize_(bufferSize)
+    , maxFree_(maxFree)
+{
+}
+
+std::vector<char> BufferPool::acquire()
+{
+    if (!freeList_.empty())
+    {
+        std::vector<char> buffer(std::move(freeList_.back()));
+        freeList_.pop_back();
+        return buffer;
+    }
+    return std::vector<char>(bufferSize_);
+}
+
+void BufferPool::release(std::vector<char> buffer)
+{
+    if (buffer.size() == bufferSize_ && buffer.capacity() == bufferSize_ && freeList_.size() < maxFree_)
+    {
+        freeList_.push_back(std::move(buffer));
+    }
+    // 其他情况buffer在这里析构，内存还给系统
+}
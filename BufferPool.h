@@ -0,0 +1,32 @@
+#pragma once
+
+#include "noncopyable.h"
+
+#include <vector>
+#include <stddef.h>
+
+/**
+ * Buffer底层内存（std::vector<char>）的池子，每个EventLoop一个，给开启了setReleaseIdleBuffers的连接用
+ * 连接的inputBuffer_读之前从这里取一块，处理完读空了再还回来：大部分时间没有数据的连接不占缓冲区
+ * 只缓存标准大小（bufferSize字节）的块，扩容过的大块还回来时直接释放，这样缓冲区也能缩回去
+ * 只在loop线程里使用，不加锁
+ */
+class BufferPool : noncopyable
+{
+public:
+    static const size_t kDefaultMaxFree = 1024; // 每个loop最多缓存1M左右
+
+    BufferPool(size_t bufferSize, size_t maxFree = kDefaultMaxFree);
+
+    std::vector<char> acquire();
+    // 按值接收，调用者的vector一定会被移空
+    void release(std::vector<char> buffer);
+
+    size_t bufferSize() const { return bufferSize_; }
+    size_t freeCount() const { return freeList_.size(); }
+
+private:
+    const size_t bufferSize_;
+    const size_t maxFree_;
+    std::vector<std::vector<char>> freeList_;
+};
@@ -0,0 +1,374 @@
+#include "ChainBuffer.h"
+#include "SlabPool.h"
+
+#include <algorithm>
+#include <errno.h>
+#include <string.h>
+#include <sys/uio.h>
+#include <sys/sendfile.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <linux/errqueue.h>
+#include <unistd.h>
+
+// 老的glibc头文件里没有这些定义（内核4.14以后才支持）
+#ifndef MSG_ZEROCOPY
+#define MSG_ZEROCOPY 0x4000000
+#endif
+#ifndef SO_EE_ORIGIN_ZEROCOPY
+#define SO_EE_ORIGIN_ZEROCOPY 5
+#endif
+#ifndef SO_EE_CODE_ZEROCOPY_COPIED
+#define SO_EE_CODE_ZEROCOPY_COPIED 1
+#endif
+
+ChainBuffer::ChainBuffer(std::shared_ptr<SlabPool> pool)
+    : pool_(std::move(pool))
+    , readable_(0)
+    , zeroCopyThreshold_(0)
+    , nextZeroCopyId_(0)
+{
+}
+
+ChainBuffer::~ChainBuffer()
+{
+    retrieveAll();
+}
+
+const char* ChainBuffer::peek() const
+{
+    if (segments_.empty() || segments_.front().data == nullptr)
+    {
+        return nullptr;
+    }
+    const Segment &front = segments_.front();
+    return front.data + front.readIndex;
+}
+
+size_t ChainBuffer::peekableBytes() const
+{
+    if (segments_.empty() || segments_.front().data == nullptr)
+    {
+        return 0;
+    }
+    const Segment &front = segments_.front();
+    return front.writeIndex - front.readIndex;
+}
+
+// 读完的slab马上还给池子，外部数据就是放掉owner的引用
+void ChainBuffer::popFront()
+{
+    if (segments_.front().slab)
+    {
+        pool_->deallocate(segments_.front().slab);
+    }
+    segments_.pop_front();
+}
+
+void ChainBuffer::retrieve(size_t len)
+{
+    len = std::min(len, readable_);
+    readable_ -= len;
+    while (len > 0)
+    {
+        Segment &front = segments_.front();
+        size_t n = std::min(len, front.writeIndex - front.readIndex);
+        front.readIndex += n;
+        len -= n;
+        if (front.readIndex == front.writeIndex)
+        {
+            popFront();
+        }
+    }
+}
+
+void ChainBuffer::retrieveAll()
+{
+    while (!segments_.empty())
+    {
+        popFront();
+    }
+    readable_ = 0;
+}
+
+void ChainBuffer::shrink()
+{
+    segments_.shrink();
+    zeroCopyPending_.shrink();
+}
+
+std::string ChainBuffer::retrieveAllAsString()
+{
+    return retrieveAsString(readable_);
+}
+
+std::string ChainBuffer::retrieveAsString(size_t len)
+{
+    len = std::min(len, readable_);
+    std::string result;
+    result.reserve(len);
+    size_t left = len;
+    for (const Segment &seg : segments_)
+    {
+        if (left == 0)
+        {
+            break;
+        }
+        size_t n = std::min(left, seg.writeIndex - seg.readIndex);
+        if (seg.fileFd >= 0) // 文件段只能读出来
+        {
+            size_t start = result.size();
+            result.resize(start + n);
+            ssize_t nr = ::pread(seg.fileFd, &result[start], n, seg.fileOffset + seg.readIndex);
+            result.resize(start + (nr > 0 ? nr : 0));
+        }
+        else
+        {
+            result.append(seg.data + seg.readIndex, n);
+        }
+        left -= n;
+    }
+    retrieve(len);
+    return result;
+}
+
+void ChainBuffer::append(const char *data, size_t len)
+{
+    const size_t slabSize = pool_->slabSize();
+    readable_ += len;
+    while (len > 0)
+    {
+        if (segments_.empty() || segments_.back().slab == nullptr || segments_.back().writeIndex == slabSize)
+        {
+            Segment seg;
+            seg.slab = pool_->allocate();
+            seg.data = seg.slab;
+            seg.readIndex = seg.writeIndex = 0;
+            seg.fileFd = -1;
+            seg.fileOffset = 0;
+            segments_.push_back(std::move(seg));
+        }
+        Segment &back = segments_.back();
+        size_t n = std::min(len, slabSize - back.writeIndex);
+        memcpy(back.slab + back.writeIndex, data, n);
+        back.writeIndex += n;
+        data += n;
+        len -= n;
+    }
+}
+
+void ChainBuffer::appendRef(const char *data, size_t len, std::shared_ptr<const void> owner)
+{
+    if (len < kMinRefBytes)
+    {
+        append(data, len);
+        return;
+    }
+    Segment seg;
+    seg.slab = nullptr;
+    seg.data = data;
+    seg.readIndex = 0;
+    seg.writeIndex = len;
+    seg.fileFd = -1;
+    seg.fileOffset = 0;
+    seg.owner = std::move(owner);
+    segments_.push_back(std::move(seg));
+    readable_ += len;
+}
+
+void ChainBuffer::appendFile(int fileFd, off_t offset, size_t len, std::shared_ptr<const void> owner)
+{
+    if (len == 0)
+    {
+        return;
+    }
+    Segment seg;
+    seg.slab = nullptr;
+    seg.data = nullptr;
+    seg.readIndex = 0;
+    seg.writeIndex = len;
+    seg.fileFd = fileFd;
+    seg.fileOffset = offset;
+    seg.owner = std::move(owner);
+    segments_.push_back(std::move(seg));
+    readable_ += len;
+}
+
+int ChainBuffer::toIovec(struct iovec *iov, int maxIov, size_t maxBytes) const
+{
+    int count = 0;
+    for (const Segment &seg : segments_)
+    {
+        if (count >= maxIov || maxBytes == 0 || seg.fileFd >= 0)
+        {
+            break;
+        }
+        size_t n = std::min(maxBytes, seg.writeIndex - seg.readIndex);
+        iov[count].iov_base = const_cast<char*>(seg.data + seg.readIndex);
+        iov[count].iov_len = n;
+        maxBytes -= n;
+        ++count;
+    }
+    return count;
+}
+
+void ChainBuffer::enableZeroCopy(size_t thresholdBytes, std::shared_ptr<ZeroCopyStats> stats)
+{
+    zeroCopyThreshold_ = thresholdBytes;
+    zeroCopyStats_ = std::move(stats);
+}
+
+ssize_t ChainBuffer::writeFd(int fd, int *saveErrno, size_t maxBytes)
+{
+    if (!segments_.empty() && segments_.front().fileFd >= 0)
+    {
+        const Segment &front = segments_.front();
+        off_t offset = front.fileOffset + front.readIndex;
+        size_t len = std::min(maxBytes, front.writeIndex - front.readIndex);
+        ssize_t n = ::sendfile(fd, front.fileFd, &offset, len);
+        if (n < 0)
+        {
+            *saveErrno = errno;
+        }
+        else if (n == 0 && len > 0) // 文件比登记的长度短（被截断了），这一段永远发不完
+        {
+            *saveErrno = EIO;
+            n = -1;
+        }
+        return n;
+    }
+
+    if (!segments_.empty() && zeroCopyEligible(segments_.front()))
+    {
+        ssize_t n = writeZeroCopy(fd, saveErrno, maxBytes);
+        if (n >= 0 || *saveErrno != ENOBUFS)
+        {
+            return n;
+        }
+        // 超过了optmem的限制，这一次退回到普通的writev
+        if (zeroCopyStats_)
+        {
+            ++zeroCopyStats_->fallbacks;
+        }
+    }
+
+    struct iovec iov[kMaxIovec];
+    int iovcnt = toIovec(iov, kMaxIovec, maxBytes);
+    if (zeroCopyThreshold_ > 0)
+    {
+        // 后面的大段留给下一次零拷贝发送
+        for (int i = 1; i < iovcnt; ++i)
+        {
+            if (zeroCopyEligible(segments_[i]))
+            {
+                iovcnt = i;
+                break;
+            }
+        }
+    }
+    ssize_t n = ::writev(fd, iov, iovcnt);
+    if (n < 0)
+    {
+        *saveErrno = errno;
+    }
+    return n;
+}
+
+// 从头开始连续的外部数据段用一次MSG_ZEROCOPY的sendmsg发出去
+// 发出去的那些段的owner记到zeroCopyPending_里，retrieve以后数据也还有效，直到内核通知完成
+ssize_t ChainBuffer::writeZeroCopy(int fd, int *saveErrno, size_t maxBytes)
+{
+    struct iovec iov[kMaxIovec];
+    int iovcnt = 0;
+    for (const Segment &seg : segments_)
+    {
+        if (iovcnt >= kMaxIovec || maxBytes == 0 || !zeroCopyEligible(seg))
+        {
+            break;
+        }
+        size_t n = std::min(maxBytes, seg.writeIndex - seg.readIndex);
+        iov[iovcnt].iov_base = const_cast<char*>(seg.data + seg.readIndex);
+        iov[iovcnt].iov_len = n;
+        maxBytes -= n;
+        ++iovcnt;
+    }
+
+    struct msghdr msg;
+    memset(&msg, 0, sizeof msg);
+    msg.msg_iov = iov;
+    msg.msg_iovlen = iovcnt;
+    ssize_t n = ::sendmsg(fd, &msg, MSG_ZEROCOPY);
+    if (n < 0)
+    {
+        *saveErrno = errno;
+        return n;
+    }
+
+    // 没有发出任何数据的sendmsg不占编号
+    if (n > 0)
+    {
+        size_t left = n;
+        for (int i = 0; i < iovcnt && left > 0; ++i)
+        {
+            ZeroCopyRef ref;
+            ref.id = nextZeroCopyId_;
+            ref.owner = segments_[i].owner;
+            zeroCopyPending_.push_back(std::move(ref));
+            left -= std::min(left, iov[i].iov_len);
+        }
+        ++nextZeroCopyId_;
+    }
+    return n;
+}
+
+int ChainBuffer::reapZeroCopy(int fd)
+{
+    int notifications = 0;
+    for (;;)
+    {
+        char control[128];
+        struct msghdr msg;
+        memset(&msg, 0, sizeof msg);
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof control;
+        if (::recvmsg(fd, &msg, MSG_ERRQUEUE) < 0)
+        {
+            break; // EAGAIN：错误队列读空了
+        }
+
+        for (struct cmsghdr *cm = CMSG_FIRSTHDR(&msg); cm != nullptr; cm = CMSG_NXTHDR(&msg, cm))
+        {
+            if (!((cm->cmsg_level == SOL_IP && cm->cmsg_type == IP_RECVERR)
+                || (cm->cmsg_level == SOL_IPV6 && cm->cmsg_type == IPV6_RECVERR)))
+            {
+                continue;
+            }
+            const struct sock_extended_err *serr = reinterpret_cast<const struct sock_extended_err*>(CMSG_DATA(cm));
+            if (serr->ee_errno != 0 || serr->ee_origin != SO_EE_ORIGIN_ZEROCOPY)
+            {
+                continue;
+            }
+
+            // [ee_info, ee_data] 这个区间的sendmsg都完成了
+            uint32_t hi = serr->ee_data;
+            uint32_t count = hi - serr->ee_info + 1;
+            while (!zeroCopyPending_.empty() && static_cast<int32_t>(zeroCopyPending_.front().id - hi) <= 0)
+            {
+                zeroCopyPending_.pop_front();
+            }
+            if (zeroCopyStats_)
+            {
+                if (serr->ee_code & SO_EE_CODE_ZEROCOPY_COPIED)
+                {
+                    zeroCopyStats_->fallbacks += count;
+                }
+                else
+                {
+                    zeroCopyStats_->hits += count;
+                }
+            }
+            ++notifications;
+        }
+    }
+    return notifications;
+}
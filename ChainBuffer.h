@@ -0,0 +1,120 @@
+#pragma once
+
+#include "noncopyable.h"
+#include "VectorQueue.h"
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <stdint.h>
+#include <sys/types.h>
+
+class SlabPool;
+struct iovec;
+
+// MSG_ZEROCOPY的统计，一个TcpServer的所有连接共用一份，按内核确认的sendmsg次数计
+struct ZeroCopyStats
+{
+    ZeroCopyStats() : hits(0), fallbacks(0) {}
+    std::atomic<uint64_t> hits; // 内核确认没有拷贝
+    std::atomic<uint64_t> fallbacks; // 内核确认还是拷贝了（比如回环、网卡不支持），或者ENOBUFS退回到普通writev
+};
+
+/**
+ * 由固定大小的slab串起来的缓冲区，接口和Buffer的 peek/retrieve/append 一致，用作TcpConnection的发送缓冲区
+ * Buffer是一整块vector，扩容要整体拷贝，而且只增不减：一次大响应以后这个连接就一直占着峰值内存
+ * ChainBuffer追加数据只是往后挂新的slab，不搬已有的数据；slab一读完就还给所在loop的SlabPool，空的时候不占任何slab
+ * 除了slab，链上还可以挂引用外部数据的段（appendRef），由owner保证数据在发完之前一直有效，不用拷贝
+ * 还可以挂文件的一段（appendFile），writeFd发到它的时候用sendfile，文件内容不经过用户态
+ * enableZeroCopy以后，足够大的外部数据段用MSG_ZEROCOPY发送，owner要等内核从错误队列通知发送完成（reapZeroCopy）才放掉
+ * 只能在连接所在的loop线程里使用
+ */
+class ChainBuffer : noncopyable
+{
+public:
+    explicit ChainBuffer(std::shared_ptr<SlabPool> pool);
+    ~ChainBuffer();
+
+    // 所有slab里可读数据的总长度
+    size_t readableBytes() const { return readable_; }
+
+    // 第一个slab里可读数据的起始地址和长度，数据不一定是连续的，需要全部数据时用toIovec
+    // 第一段是文件时返回nullptr和0
+    const char* peek() const;
+    size_t peekableBytes() const;
+
+    void retrieve(size_t len);
+    void retrieveAll();
+    std::string retrieveAllAsString();
+    std::string retrieveAsString(size_t len);
+
+    // 把[data, data+len]追加到末尾，放不下就从SlabPool再取slab
+    void append(const char *data, size_t len);
+    // 不拷贝，直接把[data, data+len]挂到链尾，owner持有数据，这一段发完（retrieve掉）才释放
+    // 比kMinRefBytes短的数据挂一段不如直接拷贝划算，还是走append
+    void appendRef(const char *data, size_t len, std::shared_ptr<const void> owner);
+    // 把文件fileFd从offset开始的len字节挂到链尾，owner保证fileFd在发完之前不被关闭
+    void appendFile(int fileFd, off_t offset, size_t len, std::shared_ptr<const void> owner);
+
+    // 从头开始最多maxBytes字节的内存数据填进iov（最多maxIov个，遇到文件段就停），返回用了几个iovec
+    int toIovec(struct iovec *iov, int maxIov, size_t maxBytes = SIZE_MAX) const;
+
+    // 把最多maxBytes字节发送到fd，和Buffer::writeFd一样不会retrieve
+    // 第一段是文件就sendfile这一段，否则writev到下一个文件段之前，所以返回值比maxBytes小不代表socket写满了
+    ssize_t writeFd(int fd, int *saveErrno, size_t maxBytes = SIZE_MAX);
+
+    // 发空了（也没有等内核通知的零拷贝数据）时，把记录各段的数组的内存也放掉
+    // slab一读完就已经还给SlabPool了，调用以后空的ChainBuffer不占任何堆内存
+    void shrink();
+
+    // 链上有几段（slab、外部数据、文件都算）
+    size_t numSegments() const { return segments_.size(); }
+
+    // 剩余长度不小于thresholdBytes的外部数据段用MSG_ZEROCOPY发送，fd要已经设置了SO_ZEROCOPY；0表示关闭
+    // slab会被马上复用，不能零拷贝，所以只对appendRef挂上来的段生效
+    void enableZeroCopy(size_t thresholdBytes, std::shared_ptr<ZeroCopyStats> stats);
+    size_t zeroCopyThreshold() const { return zeroCopyThreshold_; }
+    // 已经用MSG_ZEROCOPY发出去、内核还没通知完成的数据还有几段引用
+    size_t zeroCopyPending() const { return zeroCopyPending_.size(); }
+    // 读空fd的错误队列，放掉内核已经通知完成的owner；返回收到了几条完成通知
+    int reapZeroCopy(int fd);
+
+    static const int kMaxIovec = 64; // 一次writev最多带多少块
+    static const size_t kMinRefBytes = 512;
+
+private:
+    struct Segment
+    {
+        char *slab; // 从SlabPool取的内存，外部数据和文件时为nullptr
+        const char *data; // 数据的起始地址，slab时等于slab，文件时为nullptr
+        size_t readIndex;
+        size_t writeIndex;
+        int fileFd; // 文件段的fd，内存段为-1
+        off_t fileOffset; // readIndex为0时对应的文件偏移
+        std::shared_ptr<const void> owner; // 外部数据或文件的所有者
+    };
+
+    void popFront();
+    bool zeroCopyEligible(const Segment &seg) const
+    {
+        return zeroCopyThreshold_ > 0 && seg.owner && seg.slab == nullptr && seg.fileFd < 0
+            && seg.writeIndex - seg.readIndex >= zeroCopyThreshold_;
+    }
+    ssize_t writeZeroCopy(int fd, int *saveErrno, size_t maxBytes);
+
+    // 一次MSG_ZEROCOPY的sendmsg用到的数据：内核按socket给每次成功的sendmsg编号，完成通知里是编号的区间
+    struct ZeroCopyRef
+    {
+        uint32_t id;
+        std::shared_ptr<const void> owner;
+    };
+
+    std::shared_ptr<SlabPool> pool_;
+    VectorQueue<Segment> segments_; // 空的时候不占堆内存
+    size_t readable_;
+
+    size_t zeroCopyThreshold_;
+    uint32_t nextZeroCopyId_;
+    VectorQueue<ZeroCopyRef> zeroCopyPending_;
+    std::shared_ptr<ZeroCopyStats> zeroCopyStats_;
+};
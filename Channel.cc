@@ -18,6 +18,7 @@ Channel::Channel(EventLoop *loop, int fd)
     , events_(0)
     , revents_(0)
     , index_(-1)
+    , edgeTriggered_(false)
     , tied_(false)
 {
 
@@ -74,7 +75,7 @@ void Channel::handleEvent(Timestamp receiveTime)
 // 根据poller通知的channel发生的具体事件，由channel负责具体调用的回调操作
 void Channel::handleEventWithGuard(Timestamp receiveTime)
 {   
-    LOG_INFO("channel handleEvent revents:%d", revents_);
+    LOG_TRACE("channel handleEvent revents:%d", revents_);
 
     // read write close error
     if (revents_ & (EPOLLIN | EPOLLPRI))
@@ -2,6 +2,7 @@
 
 #include "noncopyable.h"
 #include "Timestamp.h"
+#include "InlineFunction.h"
 
 #include <functional>
 #include <memory>
@@ -20,8 +21,12 @@ public:
     // https://blog.csdn.net/qq_42595835/article/details/131117121 std::function 可调用对象
     // 使用std::function通用多态函数包装器，将类型EventCallback和ReadEventCallback定义成function对象，将函数存储和操作为对象的方式
     // 不用typedef，而用using定义类型
-    using EventCallback =  std::function<void()>; // 事件回调
-    using ReadEventCallback = std::function<void(Timestamp)>; // 只读事件回调  // 用function实现对bind绑定的函数对象的类型保留
+    // 回调用只能移动的InlineFunction存放，std::bind(&TcpConnection::handleRead, this, _1)这种不会再触发堆分配
+    // Channel的回调都是 std::bind(&X::handleXxx, this) 这种：成员函数指针（两个指针大小）+ this，内联存储留3个指针就够了
+    // 每个连接有一个Channel四个回调，用EventLoop::Functor那样64字节的存储每个连接要多两百多字节；放不下的还是会退回到堆上
+    static const size_t kCallbackInlineSize = 3 * sizeof(void*);
+    using EventCallback =  InlineFunction<void(), kCallbackInlineSize, alignof(void*)>; // 事件回调
+    using ReadEventCallback = InlineFunction<void(Timestamp), kCallbackInlineSize, alignof(void*)>; // 只读事件回调  // 用function实现对bind绑定的函数对象的类型保留
 
     Channel(EventLoop *loop, int fd);
     ~Channel();
@@ -55,6 +60,11 @@ public:
     void disableWriting() {events_ &= ~kWriteEvent; update();}
     void disableAll() {events_ = kNoneEvent; update(); } // 都不感兴趣
 
+    // 边缘触发：注册到epoll时带上EPOLLET，要在第一次enableReading之前设置
+    // 打开以后回调必须把fd读/写到EAGAIN（或者自己安排继续处理），否则不会再收到通知
+    void setEdgeTriggered(bool on) { edgeTriggered_ = on; }
+    bool edgeTriggered() const { return edgeTriggered_; }
+
     // 返回fd当前的事件状态
     bool isNoneEvent() const { return events_ == kNoneEvent; }
     bool isWriting() const { return events_ & kWriteEvent; }
@@ -85,6 +95,7 @@ private: //内部接口
     int events_; // 注册fd感兴趣的事件
     int revents_; // poller返回 的具体发生的事件
     int index_;
+    bool edgeTriggered_; // 是否用EPOLLET注册
 
     std::weak_ptr<void> tie_; //弱指针 绑定用处  关于 弱指针和强指针 https://blog.csdn.net/qq_38410730/article/details/105903979
     bool tied_; // 判断绑没绑定
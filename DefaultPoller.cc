@@ -1,17 +1,24 @@
 #include "Poller.h"
 #include "EPollPoller.h"
+#include "IoUringPoller.h"
+#include "Logger.h"
 
 #include <stdlib.h>
 
-Poller* Poller::newDefaultPoller(EventLoop *loop)
+Poller* Poller::newDefaultPoller(EventLoop *loop, Backend backend)
 {
-    if (::getenv("MUDUO_USE_POLL"))
+    if (backend == kDefault)
     {
-        return nullptr; // 生成poll实例
+        backend = ::getenv("MUDUO_USE_IOURING") ? kIoUring : kEPoll;
     }
-    else
+
+    if (backend == kIoUring)
     {
-        return new EPollPoller(loop); // 生成epoll实例
+        if (IoUringPoller::isSupported())
+        {
+            return new IoUringPoller(loop); // 生成io_uring实例
+        }
+        LOG_ERROR("io_uring is not supported by this kernel, fall back to epoll");
     }
+    return new EPollPoller(loop); // 生成epoll实例
 }
-
@@ -33,8 +33,8 @@ EPollPoller::~EPollPoller()
 // ⭐ epoll_wait 会一直执行着
 Timestamp EPollPoller::poll(int timeoutMs, ChannelList *arctiveChannels)
 {
-    // 实际上应该用LOG_DEBUG输出日志更为合理
-    LOG_INFO("func = %s => fd total count = %lu /n", __FUNCTION__, channels_.size());
+    // 每次poll都会执行，只在TRACE级别输出
+    LOG_TRACE("func = %s => fd total count = %lu", __FUNCTION__, numChannels());
     // epoll_wait 的第二个参数需要传入一个 epoll_event类型的地址
     // &*events_.begin() events_.begin()获得首个元素的迭代器，然后通过*解引用获取首个元素，最后&取地址
     // static_cast 类型安全的转换 因为epoll_wait输入的是一个int
@@ -46,23 +46,23 @@ Timestamp EPollPoller::poll(int timeoutMs, ChannelList *arctiveChannels)
 
     if (numEvents > 0)
     {
-        LOG_INFO("%d events happened !", numEvents);
+        LOG_TRACE("%d events happened !", numEvents);
         fillActiveChannles(numEvents, arctiveChannels);
         if (numEvents == events_.size()) // 所有监听的事件都发生了，events_数组需要扩容了
         {
             events_.resize(events_.size() * 2);
         }
-        else if (numEvents == 0) // epoll_wait 这一轮没有监听到事件，超时了
-        {
-            LOG_DEBUG("%s timeout ! \n", __FUNXTION__);
-        }
-        else 
+    }
+    else if (numEvents == 0) // epoll_wait 这一轮没有监听到事件，超时了
+    {
+        LOG_TRACE("%s timeout !", __FUNCTION__);
+    }
+    else 
+    {
+        if (saveErrno != EINTR) // 不等于外部中断，是由其他错误类型造成的
         {
-            if (saveErrno != EINTR) // 不等于外部中断，是由其他错误类型造成的
-            {
-                errno = saveErrno;
-                LOG_ERROR("EPollerPoll::poll() error !"); 
-            }
+            errno = saveErrno;
+            LOG_ERROR("EPollerPoll::poll() error !"); 
         }
     }
     return now;
@@ -73,19 +73,18 @@ Timestamp EPollPoller::poll(int timeoutMs, ChannelList *arctiveChannels)
 /**
  *                EventLoop => Poller.poll 
  * ChannelList  add/remove/mod->  Poller
- *                          ChannelMap <fd, Channel*>
+ *                          ChannelMap [fd] -> Channel*
 */
 // 从Poller中更新channel的逻辑
 void EPollPoller::updateChannel(Channel *channel)
 {
     const int index = channel->index();
-    LOG_INFO("func = %s => fd= %d events=%d index=%d \n", __FUNCTION__, channel->fd(), channel->events(), index);
+    LOG_TRACE("func = %s => fd= %d events=%d index=%d", __FUNCTION__, channel->fd(), channel->events(), index);
 
     if (index == kNew || index == kDeleted){
         if (index == kNew)
         {
-            int fd = channel->fd();
-            channels_[fd] = channel; // channels_ 是抽象基类Poller的map类型的成员变量
+            addChannel(channel); // channels_ 是抽象基类Poller里按fd下标的数组
         }
         channel->set_index(kAdded);
         update(EPOLL_CTL_ADD, channel);
@@ -96,6 +95,7 @@ void EPollPoller::updateChannel(Channel *channel)
         if (channel->isNoneEvent()) // 如果 fd 对事件都不感兴趣了
         {
             update(EPOLL_CTL_DEL, channel); // 删除
+            channel->set_index(kDeleted);
         } 
         else // fd 还是对一些事件感兴趣的
         {
@@ -108,13 +108,13 @@ void EPollPoller::updateChannel(Channel *channel)
 void EPollPoller::removeChannel(Channel *channel)
 {
     int fd = channel->fd(); 
-    channels_.erase(fd); // channels_是个 unordered_map<int, Channel*>
+    eraseChannel(fd);
 
     int index = channel->index();
 
-    LOG_INFO("func = %s => fd= %d events=%d index=%d \n", __FUNCTION__, channel->fd(), channel->events(), index);
+    LOG_TRACE("func = %s => fd= %d events=%d index=%d", __FUNCTION__, channel->fd(), channel->events(), index);
 
-    if (index = kAdded) // 如果在 channel已经在Poller里了，那么就删除掉
+    if (index == kAdded) // 如果在 channel已经在Poller里了，那么就删除掉
     {
         update(EPOLL_CTL_DEL, channel);
     }
@@ -142,6 +142,10 @@ void EPollPoller::update(int operation, Channel *channel)
     int fd = channel->fd();
 
     event.events = channel->events(); // channel中fd感兴趣事件赋值给evnet
+    if (channel->edgeTriggered())
+    {
+        event.events |= EPOLLET;
+    }
     event.data.fd = fd; // epoll_event中数据联合体中的fd，设置为当前channel的fd
     event.data.ptr = channel; // epoll_event中数据联合体中的指针，指向当前的channel，相当于绑定到channel上了
    
@@ -2,6 +2,11 @@
 #include "Logger.h"
 #include "Poller.h"
 #include "Channel.h"
+#include "TimerQueue.h"
+#include "TimingWheel.h"
+#include "SlabPool.h"
+#include "BufferPool.h"
+#include "Buffer.h"
 
 #include <sys/eventfd.h>
 #include <unistd.h>
@@ -28,15 +33,23 @@ int createEventfd()
 }
 
 // 构造函数
-EventLoop::EventLoop()
+EventLoop::EventLoop(Poller::Backend backend)
     : looping_(false)
     , quit_(false)
     , callingPendingFunctors_(false)
     , threadId_(CurrentThread::tid())
-    , poller_(Poller::newDefaultPoller(this))
+    , poller_(Poller::newDefaultPoller(this, backend))
     , wakeupFd_(createEventfd())
     , wakeupChannel_(new Channel(this, wakeupFd_))//this:需要知道Channnel所在的loop
+    , timerQueue_(new TimerQueue(this))
+    , slabPool_(std::make_shared<SlabPool>())
+    , bufferPool_(new BufferPool(Buffer::kCheapPrepend + Buffer::kInitialSize))
     , currentActiveChannel_(nullptr)
+    , wakeupPending_(false)
+    , suppressedWakeups_(0)
+    , deferrals_(0)
+    , numConnections_(0)
+    , queuedWork_(0)
 {
     LOG_DEBUG("EventLoop created %p in thread %d \n", this, threadId_);
     if (t_loopInThisThread)//这个线程已经有loop了，就不创建了 
@@ -55,6 +68,7 @@ EventLoop::EventLoop()
 // 析构函数
 EventLoop::~EventLoop()
 {
+    timingWheel_.reset(); // 时间轮要在定时器队列之前销毁，它析构时要cancel自己的tick定时器
     wakeupChannel_->disableAll();
     wakeupChannel_->remove();
     ::close(wakeupFd_);
@@ -74,9 +88,12 @@ void EventLoop::loop()
     {
         //先清空activeChannels_容器
         activeChannels_.clear();
+        //上一轮推迟下来的工作在这一轮执行，执行过程中再推迟的留到下一轮
+        runningDeferred_.swap(deferredFunctors_);
         //1、监听两类fd   一种是client的fd，一种wakeupfd
         //通过poller的poll方法底层调用  epoll_wait 把活跃Channel都放到activeChannels_容器中
-        pollReturnTime_ = poller_->poll(kPollTimeMs, &activeChannels_);
+        //有推迟的工作时不能阻塞，只是看一眼有没有新的事件
+        pollReturnTime_ = poller_->poll(runningDeferred_.empty() ? kPollTimeMs : 0, &activeChannels_);
 
         //2、遍历 activeChannels_ 调用Channel中的 handleEvent 去执行具体事件类型的操作
         for (Channel *channel : activeChannels_)
@@ -84,6 +101,15 @@ void EventLoop::loop()
             //Poller能监听哪些channel发生事件了，然后上报给EventLoop，EventLoop通知channel处理相应的事件
             channel->handleEvent(pollReturnTime_);//事先已经绑定好
         }
+        // 新的事件处理完，再接着处理上一轮预算用完的连接
+        for (Functor &cb : runningDeferred_)
+        {
+            cb();
+        }
+        queuedWork_.fetch_sub(static_cast<int>(runningDeferred_.size()), std::memory_order_relaxed);
+        runningDeferred_.clear();
+        // 事件回调里登记的收尾工作，比如auto-cork时每个连接攒下的数据合成一次写
+        runEndOfIterationTasks();
  
         // 3、执行当前EventLoop事件循环需要处理的 回调 操作
         /** mainLoop只做accept新用户的连接的工作  （mainLoop相当于mainReactor）
@@ -132,7 +158,7 @@ void EventLoop::runInLoop(Functor cb)
     }
     else //在非当前loop线程中执行cb , 就需要唤醒loop所在线程，执行cb
     {
-        queueInLoop(cb);
+        queueInLoop(std::move(cb));
     }   
 }
 
@@ -140,16 +166,23 @@ void EventLoop::runInLoop(Functor cb)
 //一个loop运行在自己的线程里。比如在subloop2调用subloop3的 runInLoop
 void EventLoop::queueInLoop(Functor cb)
 {   
-    {
-    std::unique_lock<std::mutex> lock(mutex_); //智能锁，因为有并发的访问
-    pendingFunctors_.emplace_back(cb);//C++11 emplace_back： 直接在底层vector内存里构造cb，而push_back是拷贝构造
-    }
+    queuedWork_.fetch_add(1, std::memory_order_relaxed);
+    pendingFunctors_.push(std::move(cb)); // 无锁入队，多个线程同时post不会在一把锁上排队
 
     //唤醒相应的，需要执行上面回调操作的loop的线程了
     // || callingPendingFunctors_的意思是：当前loop正在执行回调，但是loop又有了新的回调
+    // 多个线程同时post时，只有doPendingFunctors清掉标志以后的第一个post需要真正write一次eventfd
+    // 后面的回调反正会被同一批取走，省掉这次系统调用
     if (!isInLoopThread() || callingPendingFunctors_) 
     {
-        wakeup();//唤醒loop所在线程，继续执行回调 
+        if (!wakeupPending_.exchange(true))
+        {
+            wakeup();//唤醒loop所在线程，继续执行回调 
+        }
+        else
+        {
+            suppressedWakeups_.fetch_add(1, std::memory_order_relaxed);
+        }
     }
 
 }
@@ -178,6 +211,36 @@ void EventLoop::wakeup()
     }
 }
 
+TimerId EventLoop::runAt(Timestamp time, TimerCallback cb)
+{
+    return timerQueue_->addTimer(std::move(cb), time, 0.0);
+}
+
+TimerId EventLoop::runAfter(double delay, TimerCallback cb)
+{
+    Timestamp time(addTime(Timestamp::now(), delay));
+    return runAt(time, std::move(cb));
+}
+
+TimerId EventLoop::runEvery(double interval, TimerCallback cb)
+{
+    Timestamp time(addTime(Timestamp::now(), interval));
+    return timerQueue_->addTimer(std::move(cb), time, interval);
+}
+
+void EventLoop::cancel(TimerId timerId)
+{
+    timerQueue_->cancel(timerId);
+}
+
+void EventLoop::enableTimingWheel(double tickSeconds, size_t numSlots)
+{
+    if (!timingWheel_)
+    {
+        timingWheel_.reset(new TimingWheel(this, tickSeconds, numSlots));
+    }
+}
+
 //EventLoop的方法，channel.cc中调用的，channel想在Poller上更新删除，但是没法直接完成，需要EventLoop调用poller的函数间接完成
 void EventLoop::updateChannel(Channel *channel)
 {
@@ -194,17 +257,40 @@ bool EventLoop::hasChannel(Channel *channel)
 
 void EventLoop::doPendingFunctors() // 执行回调  (操作具体实现在TcpServer中)
 {
-    std::vector<Functor> functors;
     callingPendingFunctors_ = true;
-    {
-        std::unique_lock<std::mutex> lock(mutex_);
-        functors.swap(pendingFunctors_);//资源交换，把pendingFunctors_ 置为空
-        //不需要pendingFunctors_了  不妨碍 mainloop向 pendingFunctors_写回调操作cb
-    }
-    for (const Functor &functor : functors)
-    {
+    // 必须在取队列之前清掉标志：清掉以后再post的回调，要么被这一批取到，要么会自己重新wakeup
+    wakeupPending_ = false;
+    // 一次把队列里现有的回调整批取走执行，执行期间其他线程push的留到下一轮（queueInLoop会再wakeup）
+    int done = 0;
+    pendingFunctors_.consumeAll([&done](Functor &functor) {
         functor();//执行当前loop需要执行的回调操作
-    }
- 
+        ++done;
+    });
+    queuedWork_.fetch_sub(done, std::memory_order_relaxed); // 整批执行完才减，执行中的回调也算积压
+    // 回调里（比如其他线程投递过来的send）攒下的数据也在这一轮发出去
+    // 放在清callingPendingFunctors_之前，flush时queueInLoop的writeComplete回调会唤醒下一轮，不会等到poll超时
+    runEndOfIterationTasks();
     callingPendingFunctors_ = false;
-}
\ No newline at end of file
+}
+
+void EventLoop::deferToNextIteration(Functor cb)
+{
+    deferredFunctors_.push_back(std::move(cb));
+    deferrals_.fetch_add(1, std::memory_order_relaxed);
+    queuedWork_.fetch_add(1, std::memory_order_relaxed);
+}
+
+// 任务执行时又登记的任务也在这一轮执行完：比如flush出错关闭连接，用户的断开回调里给其他连接send，又cork了那些连接
+// 留到下一轮的话，下一次poll没有理由不阻塞，最多要等kPollTimeMs
+void EventLoop::runEndOfIterationTasks()
+{
+    while (!endOfIterationTasks_.empty())
+    {
+        runningEndOfIteration_.swap(endOfIterationTasks_);
+        for (Functor &cb : runningEndOfIteration_)
+        {
+            cb();
+        }
+        runningEndOfIteration_.clear();
+    }
+}
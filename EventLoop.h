@@ -9,9 +9,17 @@
 #include "noncopyable.h"
 #include "Timestamp.h"
 #include "CurrentThread.h"
+#include "Callbacks.h"
+#include "TimerId.h"
+#include "MpscQueue.h"
+#include "InlineFunction.h"
+#include "Poller.h"
 
 class Channel;
-class Poller;
+class TimerQueue;
+class TimingWheel;
+class SlabPool;
+class BufferPool;
 
 // 时间循环类，主要包含两个大模块：Channel   Poller（epoll的抽象）
 class EventLoop : noncopyable
@@ -21,9 +29,11 @@ public:
     // std::function是一种通用、多态的函数封装
     // std::function的实例可以对任何可以调用的目标实体进行存储、复制、和调用操作，这些目标实体包括普通函数、Lambda表达式、函数指针、以及其它函数对象等。
     // std::function对象是对C++中现有的可调用实体的一种类型安全的包裹（我们知道像函数指针这类可调用实体，是类型不安全的）
-    using Functor = std::function<void()>; // 放一些回调函数
+    // 跨线程post的回调用InlineFunction：只能移动，小于MYMUDUO_FUNCTOR_INLINE_SIZE字节的直接存在对象里，不用在堆上分配
+    using Functor = InlineFunction<void()>; // 放一些回调函数
 
-    EventLoop();
+    // backend选择底层的IO复用，默认是epoll（环境变量MUDUO_USE_IOURING可以切到io_uring）
+    explicit EventLoop(Poller::Backend backend = Poller::kDefault);
     ~EventLoop();
 
     //开启事件循环
@@ -39,8 +49,50 @@ public:
     //把cb放入队列中，唤醒loop所在的线程，执行cb
     void queueInLoop(Functor cb);
 
+    //定时器，都是线程安全的，可以在其他线程里调用
+    //在time时刻执行cb
+    TimerId runAt(Timestamp time, TimerCallback cb);
+    //delay秒以后执行cb
+    TimerId runAfter(double delay, TimerCallback cb);
+    //每隔interval秒执行一次cb
+    TimerId runEvery(double interval, TimerCallback cb);
+    //取消定时器
+    void cancel(TimerId timerId);
+
+    //创建本loop的时间轮（已经有了就什么都不做），只能在loop所在的线程里调用
+    //tickSeconds是转一格的时间，numSlots是槽的个数
+    void enableTimingWheel(double tickSeconds, size_t numSlots);
+    //没有调用过enableTimingWheel时返回nullptr
+    TimingWheel* timingWheel() const { return timingWheel_.get(); }
+
      //用来唤醒loop所在的线程的 (mainReactor用来唤醒subReactor)
      void wakeup();
+     //因为已经有一次唤醒还没被处理而省掉的wakeup次数，用来观察合并唤醒的效果
+     uint64_t suppressedWakeups() const { return suppressedWakeups_.load(std::memory_order_relaxed); }
+
+     //把cb推迟到下一轮：下一次poll（不阻塞）处理完新的事件以后再执行，只能在loop线程里调用
+     //预算用完的连接用它接着读/写，同一个loop上其他连接的事件不用排在它后面等
+     void deferToNextIteration(Functor cb);
+     //deferToNextIteration累计被调用的次数，次数很多说明预算相对负载偏小
+     uint64_t deferrals() const { return deferrals_.load(std::memory_order_relaxed); }
+
+     //cb在这一轮处理完事件（以及执行完回调）以后执行，只能在loop线程里调用
+     //auto-cork用它在一轮结束时flush攒下的数据；去重由调用方负责
+     void addEndOfIterationTask(Functor cb) { endOfIterationTasks_.push_back(std::move(cb)); }
+     //loop()正在运行，addEndOfIterationTask登记的任务保证在这一轮结束前执行
+     bool looping() const { return looping_; }
+
+     //这个loop上还活着的TcpConnection个数，连接对象构造/析构时更新，可以在任何线程读；给EventLoopThreadPool选loop用
+     int numConnections() const { return numConnections_.load(std::memory_order_relaxed); }
+     void addConnections(int delta) { numConnections_.fetch_add(delta, std::memory_order_relaxed); }
+     //积压的工作：投递过来还没执行完的回调，加上预算用完推迟到下一轮的连接，可以在任何线程读
+     //连接数一样时，积压多的loop正忙，EventLoopThreadPool选loop时把它算进负载
+     int queuedWork() const { return queuedWork_.load(std::memory_order_relaxed); }
+
+     //本loop上连接的ChainBuffer共用的slab池
+     const std::shared_ptr<SlabPool>& slabPool() const { return slabPool_; }
+     //setReleaseIdleBuffers的连接在这里借还inputBuffer的内存，只能在loop线程里用
+     BufferPool* bufferPool() const { return bufferPool_.get(); }
 
      //EventLoop的方法,其中调用的是Poller的方法
      void updateChannel(Channel *channel);
@@ -53,6 +105,7 @@ public:
 private:
     void handleRead(); //唤醒wake up
     void doPendingFunctors(); // 执行回调
+    void runEndOfIterationTasks();
 
     using ChannelList = std::vector<Channel*>; // vector数组
     std::atomic_bool looping_; // 原子操作，通过CAS实现
@@ -68,12 +121,26 @@ private:
     // Linux内核的eventfd创建的 
     int wakeupFd_; // 主要作用：当mainLoop获取一个新用户的channel，通过轮询算法选择一个subloop（还在睡觉），然后通过该成员唤醒subloop处理channel
     std::unique_ptr<Channel> wakeupChannel_; //包括wakeupFd和感兴趣的事件 
+    std::unique_ptr<TimerQueue> timerQueue_; //定时器队列，底层是一个timerfd
+    std::unique_ptr<TimingWheel> timingWheel_; //空闲连接超时用的时间轮，由timerQueue_驱动
+    std::shared_ptr<SlabPool> slabPool_; //连接可能比loop活得久，所以用shared_ptr
+    std::unique_ptr<BufferPool> bufferPool_;
 
     ChannelList activeChannels_; //eventloop管理的所有channel
     Channel *currentActiveChannel_;
 
     std::atomic_bool callingPendingFunctors_; // 标识当前loop是否有需要执行回调的操作
-    std::vector<Functor> pendingFunctors_; //存储loop需要执行的所有的回调操作 Functor 格式
-    std::mutex mutex_; // 互斥锁，用来保护上面vector容器的线程安全操作
+    MpscQueue<Functor> pendingFunctors_; //存储loop需要执行的所有的回调操作 Functor 格式，无锁的多生产者单消费者队列
+    std::atomic_bool wakeupPending_; // 已经写过wakeupFd_，loop还没开始执行这一批回调
+    std::atomic<uint64_t> suppressedWakeups_;
+
+    std::vector<Functor> deferredFunctors_; // 下一轮要执行的
+    std::vector<Functor> runningDeferred_; // 这一轮正在执行的，和deferredFunctors_交换
+    std::atomic<uint64_t> deferrals_;
+    std::atomic_int numConnections_;
+    std::atomic_int queuedWork_;
+
+    std::vector<Functor> endOfIterationTasks_; // 这一轮结束时要执行的
+    std::vector<Functor> runningEndOfIteration_; // 和endOfIterationTasks_交换，执行时不用重新分配
 
 };
\ No newline at end of file
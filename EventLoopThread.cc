@@ -2,13 +2,15 @@
 #include "EventLoop.h"
 
 EventLoopThread::EventLoopThread(const ThreadInitCallback &cb,
-    const std::string &name) 
+    const std::string &name,
+    Poller::Backend backend) 
     : loop_(nullptr)
     , exiting_(false)
     , thread_(std::bind(&EventLoopThread::threadFunc, this), name) //绑定回调函数 Thread类构造函数有两个参数，一个函数模板，一个线程名字
     , mutex_()
     , cond_()
     , callback_(cb)
+    , backend_(backend)
 {
 
 }
@@ -43,7 +45,7 @@ EventLoop* EventLoopThread::startLoop()//开启循环
 // 下面这个方法是在单独的新线程里运行的
 void EventLoopThread::threadFunc()
 {
-    EventLoop loop; // 创建一个独立的EventLoop，和上面的线程是一一对应的，真正的 one loop per thread ！！
+    EventLoop loop(backend_); // 创建一个独立的EventLoop，和上面的线程是一一对应的，真正的 one loop per thread ！！
 
     if (callback_)//如果有回调
     {
@@ -2,6 +2,7 @@
 
 #include "noncopyable.h"
 #include "Thread.h"
+#include "Poller.h"
 
 #include <functional>
 #include <condition_variable>
@@ -16,7 +17,8 @@ class EventLoopThread : noncopyable
 public:
     using ThreadInitCallback = std::function<void (EventLoop*)>;
     EventLoopThread(const ThreadInitCallback &cb = ThreadInitCallback(),
-    const std::string &name = std::string() );
+    const std::string &name = std::string(),
+    Poller::Backend backend = Poller::kDefault);
     ~EventLoopThread();
 
     EventLoop* startLoop();
@@ -29,4 +31,5 @@ private:
     std::mutex mutex_;
     std::condition_variable cond_;
     ThreadInitCallback callback_;
+    Poller::Backend backend_; // 新线程里的EventLoop用哪种IO复用
 };
\ No newline at end of file
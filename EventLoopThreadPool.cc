@@ -1,14 +1,44 @@
 #include "EventLoopThreadPool.h"
 #include "EventLoopThread.h"
+#include "EventLoop.h"
+#include "InetAddress.h"
 
+#include <algorithm>
 #include <memory>
 
+namespace
+{
+    // 哈希环上每个loop的虚拟节点数，越多分布越均匀
+    const int kVirtualNodes = 160;
+
+    // murmur3的finalizer，把相邻的整数打散到整个32位空间
+    uint32_t mix32(uint32_t h)
+    {
+        h ^= h >> 16;
+        h *= 0x85ebca6b;
+        h ^= h >> 13;
+        h *= 0xc2b2ae35;
+        h ^= h >> 16;
+        return h;
+    }
+
+    // 选loop时的负载：连接数加上积压的工作，一个没执行完的回调/推迟的连接按一个连接算
+    // 只看连接数的话，连接数相同、但有一个正忙着处理大批投递过来的send的loop，照样会被选中
+    int loadOf(const EventLoop *loop)
+    {
+        return loop->numConnections() + loop->queuedWork();
+    }
+}
+
 EventLoopThreadPool::EventLoopThreadPool(EventLoop *baseLoop, const std::string &nameArg)
     : baseLoop_(baseLoop)
     , name_(nameArg)
     , started_(false)
     , numThreads_(0)
     , next_(0)
+    , backend_(Poller::kDefault)
+    , policy_(kRoundRobin)
+    , rngState_(2463534242u)
 {
 
 }
@@ -26,13 +56,26 @@ void EventLoopThreadPool::start(const ThreadInitCallback &cb)//开启整个事
     {
         char buf[name_.size() + 32];
         snprintf(buf, sizeof buf, "%s%d", name_.c_str(), i);
-        EventLoopThread *t = new EventLoopThread(cb, buf);
+        EventLoopThread *t = new EventLoopThread(cb, buf, backend_);
         threads_.push_back(std::unique_ptr<EventLoopThread>(t));//unique_ptr，不想手动delete
         loops_.push_back(t->startLoop());//底层创建线程，绑定一个新的EventLoop，并返回该loop的地址
     }
 
+    if (policy_ == kConsistentHash)
+    {
+        hashRing_.reserve(loops_.size() * kVirtualNodes);
+        for (size_t i = 0; i < loops_.size(); ++i)
+        {
+            for (int v = 0; v < kVirtualNodes; ++v)
+            {
+                hashRing_.push_back(std::make_pair(mix32(static_cast<uint32_t>(i * kVirtualNodes + v) * 2654435761u), loops_[i]));
+            }
+        }
+        std::sort(hashRing_.begin(), hashRing_.end());
+    }
+
     // 整个服务端只有一个线程运行着 baseloop，就是用户创建的mainloop
-    if (numThreads_ = 0 && cb) 
+    if (numThreads_ == 0 && cb)
     {
         cb(baseLoop_);
     }
@@ -55,6 +98,68 @@ EventLoop* EventLoopThreadPool::getNextLoop()
     return loop;
 }
 
+EventLoop* EventLoopThreadPool::getLoopForConnection(const InetAddress &peerAddr)
+{
+    if (loops_.empty())
+    {
+        return baseLoop_;
+    }
+    if (selector_)
+    {
+        return selector_(loops_, peerAddr);
+    }
+
+    switch (policy_)
+    {
+    case kLeastConnections:
+    {
+        EventLoop *best = loops_[0];
+        int bestLoad = loadOf(best);
+        for (size_t i = 1; i < loops_.size(); ++i)
+        {
+            int load = loadOf(loops_[i]);
+            if (load < bestLoad)
+            {
+                best = loops_[i];
+                bestLoad = load;
+            }
+        }
+        return best;
+    }
+    case kPowerOfTwoChoices:
+    {
+        rngState_ ^= rngState_ << 13;
+        rngState_ ^= rngState_ >> 17;
+        rngState_ ^= rngState_ << 5;
+        const size_t n = loops_.size();
+        if (n == 1)
+        {
+            return loops_[0];
+        }
+        // 第二个从另外n-1个loop里选，两次不会抽到同一个
+        const size_t first = rngState_ % n;
+        const size_t second = (first + 1 + (rngState_ >> 16) % (n - 1)) % n;
+        EventLoop *a = loops_[first];
+        EventLoop *b = loops_[second];
+        return loadOf(a) <= loadOf(b) ? a : b;
+    }
+    case kConsistentHash:
+    {
+        // 只用IP：同一个客户端的多条连接端口不同，也要落在同一个loop上
+        uint32_t h = mix32(peerAddr.getSockAddr()->sin_addr.s_addr);
+        auto it = std::lower_bound(hashRing_.begin(), hashRing_.end(), std::make_pair(h, static_cast<EventLoop*>(nullptr)));
+        if (it == hashRing_.end())
+        {
+            it = hashRing_.begin();
+        }
+        return it->second;
+    }
+    case kRoundRobin:
+    default:
+        return getNextLoop();
+    }
+}
+
 std::vector<EventLoop*> EventLoopThreadPool::getAllLoops() //返回池里的所有loop 
 {
     if (loops_.empty())
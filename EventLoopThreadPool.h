@@ -1,26 +1,46 @@
 #pragma once
 
 #include "noncopyable.h"
+#include "Poller.h"
 
 #include <functional>
 #include <bits/stdc++.h>
 
 class EventLoop;
 class EventLoopThread;
+class InetAddress;
 
 class EventLoopThreadPool : noncopyable
 {
 public:
     using ThreadInitCallback = std::function<void (EventLoop*)>;
+    //自定义的选loop策略：从loops里给peerAddr这个新连接挑一个，在mainloop线程里调用
+    using LoopSelector = std::function<EventLoop* (const std::vector<EventLoop*> &loops, const InetAddress &peerAddr)>;
+
+    //新连接分给哪个subloop
+    enum Policy
+    {
+        kRoundRobin, //轮询（默认）
+        kLeastConnections, //负载（连接数加上积压的工作，见EventLoop::queuedWork）最小的loop，每次要看所有loop
+        kPowerOfTwoChoices, //随机挑两个loop，取负载小的那个，loop很多时比kLeastConnections便宜，效果接近
+        kConsistentHash, //按对端IP一致性哈希，同一个客户端总是落在同一个loop上（loop里的缓存更容易命中）
+    };
     EventLoopThreadPool(EventLoop *baseLoop, const std::string &nameArg);
     ~EventLoopThreadPool();
 
     void setThreadNum(int numThreads) { numThreads_ = numThreads; }//设置底层线程的数量 
+    void setPollerBackend(Poller::Backend backend) { backend_ = backend; }//subloop使用的IO复用，在start之前调用
  
     void start(const ThreadInitCallback &cb = ThreadInitCallback());//开启整个事件循环线程
 
     //如果工作在多线程中，baseLoop_默认以 轮询 的方式分配channel给subloop
     EventLoop* getNextLoop();
+    //按设置的策略给新连接选一个loop，没有subloop时返回baseLoop
+    EventLoop* getLoopForConnection(const InetAddress &peerAddr);
+
+    //选loop的策略，在start之前调用；setLoopSelector设置了自定义策略时以它为准
+    void setPolicy(Policy policy) { policy_ = policy; }
+    void setLoopSelector(const LoopSelector &selector) { selector_ = selector; }
 
     std::vector<EventLoop*> getAllLoops(); //返回池里的所有loop 
 
@@ -33,7 +53,12 @@ private:
     std::string name_;
     bool started_;
     int numThreads_;  //线程数量
-    int next_;//做轮询的下标使用的
+    size_t next_;//做轮询的下标使用的
+    Poller::Backend backend_;
+    Policy policy_;
+    LoopSelector selector_;
+    uint32_t rngState_; // kPowerOfTwoChoices用的随机数状态（xorshift），只在mainloop线程里用
+    std::vector<std::pair<uint32_t, EventLoop*>> hashRing_; // kConsistentHash的哈希环，start时建好，按哈希值排序
     std::vector<std::unique_ptr<EventLoopThread>> threads_; //所有事件的线程
     std::vector<EventLoop*> loops_;//事件线程EventLoopThread里面的EventLoop指针
 };
\ No newline at end of file
@@ -0,0 +1,224 @@
+#pragma once
+
+#include <functional>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <cstddef>
+
+// 回调对象内联存储的默认字节数，可以在编译时 -DMYMUDUO_FUNCTOR_INLINE_SIZE=48 调整
+#ifndef MYMUDUO_FUNCTOR_INLINE_SIZE
+#define MYMUDUO_FUNCTOR_INLINE_SIZE 64
+#endif
+
+// Align是内部存储的对齐，默认按max_align_t；只放指针的小回调（Channel）用alignof(void*)，省掉补齐的字节
+template <typename Signature, size_t Capacity = MYMUDUO_FUNCTOR_INLINE_SIZE,
+          size_t Align = alignof(std::max_align_t)>
+class InlineFunction;
+
+/**
+ * 只能移动的可调用对象包装器，用来代替EventLoop::Functor和Channel回调里的std::function
+ * libstdc++的std::function只能内联存放16字节，std::bind(&TcpConnection::sendInLoop, this, data, len)、
+ * std::bind(writeCompleteCallback_, shared_from_this()) 这种都会在堆上分配一次
+ * 这里在对象内部预留Capacity字节，放得下（并且移动构造不抛异常）的可调用对象直接构造在里面，放不下的才退回到堆上
+ * 不需要拷贝，所以也不要求被包装的对象可拷贝
+ */
+template <typename R, typename... Args, size_t Capacity, size_t Align>
+class InlineFunction<R(Args...), Capacity, Align>
+{
+public:
+    InlineFunction() noexcept : ops_(nullptr) {}
+    InlineFunction(std::nullptr_t) noexcept : ops_(nullptr) {}
+
+    template <typename F,
+              typename = typename std::enable_if<
+                  !std::is_same<typename std::decay<F>::type, InlineFunction>::value>::type>
+    InlineFunction(F &&f) : ops_(nullptr)
+    {
+        init(std::forward<F>(f));
+    }
+
+    InlineFunction(InlineFunction &&other) noexcept : ops_(nullptr)
+    {
+        moveFrom(other);
+    }
+
+    InlineFunction& operator=(InlineFunction &&other) noexcept
+    {
+        if (this != &other)
+        {
+            reset();
+            moveFrom(other);
+        }
+        return *this;
+    }
+
+    InlineFunction& operator=(std::nullptr_t) noexcept
+    {
+        reset();
+        return *this;
+    }
+
+    template <typename F,
+              typename = typename std::enable_if<
+                  !std::is_same<typename std::decay<F>::type, InlineFunction>::value>::type>
+    InlineFunction& operator=(F &&f)
+    {
+        reset();
+        init(std::forward<F>(f));
+        return *this;
+    }
+
+    InlineFunction(const InlineFunction&) = delete;
+    InlineFunction& operator=(const InlineFunction&) = delete;
+
+    ~InlineFunction() { reset(); }
+
+    R operator()(Args... args) const
+    {
+        if (ops_ == nullptr)
+        {
+            throw std::bad_function_call();
+        }
+        return ops_->invoke(storage(), std::forward<Args>(args)...);
+    }
+
+    explicit operator bool() const noexcept { return ops_ != nullptr; }
+
+private:
+    using Storage = typename std::aligned_storage<
+        (Capacity < sizeof(void*) ? sizeof(void*) : Capacity), (Align < alignof(void*) ? alignof(void*) : Align)>::type;
+
+    // 每种被包装的类型一张"虚函数表"
+    struct Ops
+    {
+        R (*invoke)(void *storage, Args&&... args);
+        void (*move)(void *dst, void *src); // 把src里的对象移动到dst，并析构src
+        void (*destroy)(void *storage);
+    };
+
+    template <typename F>
+    struct Inline
+    {
+        static F* get(void *storage) { return static_cast<F*>(storage); }
+
+        static R invoke(void *storage, Args&&... args)
+        {
+            return (*get(storage))(std::forward<Args>(args)...);
+        }
+        static void move(void *dst, void *src)
+        {
+            new (dst) F(std::move(*get(src)));
+            get(src)->~F();
+        }
+        static void destroy(void *storage)
+        {
+            get(storage)->~F();
+        }
+        static const Ops ops;
+    };
+
+    // 放不下的对象在堆上，storage里只存一个指针
+    template <typename F>
+    struct Heap
+    {
+        static F*& get(void *storage) { return *static_cast<F**>(storage); }
+
+        static R invoke(void *storage, Args&&... args)
+        {
+            return (*get(storage))(std::forward<Args>(args)...);
+        }
+        static void move(void *dst, void *src)
+        {
+            new (dst) F*(get(src));
+        }
+        static void destroy(void *storage)
+        {
+            delete get(storage);
+        }
+        static const Ops ops;
+    };
+
+    template <typename F>
+    struct FitsInline
+    {
+        static const bool value = sizeof(F) <= Capacity
+            && alignof(F) <= alignof(Storage)
+            && std::is_nothrow_move_constructible<F>::value;
+    };
+
+    // 空的函数指针、空的std::function包装以后也应该是空的，Channel里靠 if (callback_) 判断
+    template <typename F>
+    static bool isEmpty(const F&) { return false; }
+    template <typename Sig>
+    static bool isEmpty(const std::function<Sig> &f) { return !f; }
+    template <typename Ret, typename... As>
+    static bool isEmpty(Ret (*f)(As...)) { return f == nullptr; }
+
+    template <typename F>
+    void init(F &&f)
+    {
+        using Functor = typename std::decay<F>::type;
+        if (isEmpty(f))
+        {
+            return;
+        }
+        construct<Functor>(std::forward<F>(f), std::integral_constant<bool, FitsInline<Functor>::value>());
+    }
+
+    template <typename Functor, typename F>
+    void construct(F &&f, std::true_type)
+    {
+        new (storage()) Functor(std::forward<F>(f));
+        ops_ = &Inline<Functor>::ops;
+    }
+
+    template <typename Functor, typename F>
+    void construct(F &&f, std::false_type)
+    {
+        new (storage()) Functor*(new Functor(std::forward<F>(f)));
+        ops_ = &Heap<Functor>::ops;
+    }
+
+    void moveFrom(InlineFunction &other) noexcept
+    {
+        if (other.ops_)
+        {
+            other.ops_->move(storage(), other.storage());
+            ops_ = other.ops_;
+            other.ops_ = nullptr;
+        }
+    }
+
+    void reset() noexcept
+    {
+        if (ops_)
+        {
+            ops_->destroy(storage());
+            ops_ = nullptr;
+        }
+    }
+
+    void* storage() const { return const_cast<void*>(static_cast<const void*>(&storage_)); }
+
+    Storage storage_;
+    const Ops *ops_;
+};
+
+template <typename R, typename... Args, size_t Capacity, size_t Align>
+template <typename F>
+const typename InlineFunction<R(Args...), Capacity, Align>::Ops
+InlineFunction<R(Args...), Capacity, Align>::Inline<F>::ops = {
+    &InlineFunction<R(Args...), Capacity, Align>::Inline<F>::invoke,
+    &InlineFunction<R(Args...), Capacity, Align>::Inline<F>::move,
+    &InlineFunction<R(Args...), Capacity, Align>::Inline<F>::destroy,
+};
+
+template <typename R, typename... Args, size_t Capacity, size_t Align>
+template <typename F>
+const typename InlineFunction<R(Args...), Capacity, Align>::Ops
+InlineFunction<R(Args...), Capacity, Align>::Heap<F>::ops = {
+    &InlineFunction<R(Args...), Capacity, Align>::Heap<F>::invoke,
+    &InlineFunction<R(Args...), Capacity, Align>::Heap<F>::move,
+    &InlineFunction<R(Args...), Capacity, Align>::Heap<F>::destroy,
+};
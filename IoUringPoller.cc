@@ -0,0 +1,409 @@
+#include "IoUringPoller.h"
+#include "Channel.h"
+#include "Logger.h"
+
+#include <algorithm>
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/epoll.h>
+#include <linux/io_uring.h>
+
+#if defined(__NR_io_uring_setup) && defined(IORING_FEAT_EXT_ARG)
+#define MYMUDUO_HAVE_IO_URING 1
+#endif
+
+#ifndef IORING_SQ_CQ_OVERFLOW // 5.8以前的头文件没有，内核 >= 5.11 一定支持
+#define IORING_SQ_CQ_OVERFLOW (1U << 1)
+#endif
+
+// channel的index_表示它在poller中的状态，和EPollPoller保持一致
+static const int kNew = -1;
+static const int kAdded = 1;
+static const int kDeleted = 2;
+
+#ifdef MYMUDUO_HAVE_IO_URING
+
+// POLL_REMOVE 自己的完成事件不需要处理
+static const uint64_t kIgnoreUserData = ~0ULL;
+
+static int sysIoUringSetup(unsigned entries, struct io_uring_params *p)
+{
+    return static_cast<int>(::syscall(__NR_io_uring_setup, entries, p));
+}
+
+static int sysIoUringEnter(int fd, unsigned toSubmit, unsigned minComplete, unsigned flags, void *arg, size_t argsz)
+{
+    return static_cast<int>(::syscall(__NR_io_uring_enter, fd, toSubmit, minComplete, flags, arg, argsz));
+}
+
+static uint64_t encodeUserData(int fd, uint32_t generation)
+{
+    return (static_cast<uint64_t>(generation) << 32) | static_cast<uint32_t>(fd);
+}
+
+bool IoUringPoller::isSupported()
+{
+    static const bool supported = [] {
+        struct io_uring_params params;
+        memset(&params, 0, sizeof params);
+        int fd = sysIoUringSetup(4, &params);
+        if (fd < 0)
+        {
+            return false;
+        }
+        ::close(fd);
+        return (params.features & IORING_FEAT_EXT_ARG) != 0;
+    }();
+    return supported;
+}
+
+IoUringPoller::IoUringPoller(EventLoop *loop)
+    : Poller(loop)
+    , ringFd_(-1)
+    , sqRing_(MAP_FAILED)
+    , sqRingSize_(0)
+    , sqesSize_(0)
+    , toSubmit_(0)
+    , cqRing_(MAP_FAILED)
+    , cqRingSize_(0)
+    , warnedEdgeTriggered_(false)
+{
+    struct io_uring_params params;
+    memset(&params, 0, sizeof params);
+    params.flags = IORING_SETUP_CQSIZE;
+    // 每个fd最多一个poll在飞，完成事件数不会超过注册的fd数加上取消请求数
+    // 连接数超过CQ大小时内核把放不下的完成事件暂存起来（IORING_FEAT_NODROP），poll()里会检查溢出标志再取一次
+    params.cq_entries = kCqEntries;
+    ringFd_ = sysIoUringSetup(kRingEntries, &params);
+    if (ringFd_ < 0)
+    {
+        LOG_FATAL("io_uring_setup error : %d \n", errno);
+    }
+
+    sqRingSize_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cqRingSize_ = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    bool singleMmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (singleMmap) // SQ和CQ共用一块映射
+    {
+        sqRingSize_ = cqRingSize_ = std::max(sqRingSize_, cqRingSize_);
+    }
+
+    sqRing_ = ::mmap(nullptr, sqRingSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd_, IORING_OFF_SQ_RING);
+    if (sqRing_ == MAP_FAILED)
+    {
+        LOG_FATAL("io_uring mmap sq ring error : %d \n", errno);
+    }
+    if (singleMmap)
+    {
+        cqRing_ = sqRing_;
+    }
+    else
+    {
+        cqRing_ = ::mmap(nullptr, cqRingSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd_, IORING_OFF_CQ_RING);
+        if (cqRing_ == MAP_FAILED)
+        {
+            LOG_FATAL("io_uring mmap cq ring error : %d \n", errno);
+        }
+    }
+
+    sqesSize_ = params.sq_entries * sizeof(struct io_uring_sqe);
+    void *sqes = ::mmap(nullptr, sqesSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd_, IORING_OFF_SQES);
+    if (sqes == MAP_FAILED)
+    {
+        LOG_FATAL("io_uring mmap sqes error : %d \n", errno);
+    }
+    sqes_ = static_cast<struct io_uring_sqe*>(sqes);
+
+    char *sq = static_cast<char*>(sqRing_);
+    sqHead_ = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+    sqTail_ = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+    sqMask_ = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+    sqEntries_ = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_entries);
+    sqArray_ = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+    sqFlags_ = reinterpret_cast<unsigned*>(sq + params.sq_off.flags);
+
+    char *cq = static_cast<char*>(cqRing_);
+    cqHead_ = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+    cqTail_ = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+    cqMask_ = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+    cqes_ = reinterpret_cast<struct io_uring_cqe*>(cq + params.cq_off.cqes);
+}
+
+IoUringPoller::~IoUringPoller()
+{
+    if (sqes_)
+    {
+        ::munmap(sqes_, sqesSize_);
+    }
+    if (cqRing_ != MAP_FAILED && cqRing_ != sqRing_)
+    {
+        ::munmap(cqRing_, cqRingSize_);
+    }
+    if (sqRing_ != MAP_FAILED)
+    {
+        ::munmap(sqRing_, sqRingSize_);
+    }
+    ::close(ringFd_);
+}
+
+// 等待至少minComplete个完成事件，timeoutMs < 0 表示一直等
+int IoUringPoller::enter(unsigned toSubmit, unsigned minComplete, unsigned flags, int timeoutMs)
+{
+    struct __kernel_timespec ts;
+    struct io_uring_getevents_arg arg;
+    memset(&arg, 0, sizeof arg);
+    if (timeoutMs >= 0)
+    {
+        ts.tv_sec = timeoutMs / 1000;
+        ts.tv_nsec = (timeoutMs % 1000) * 1000000LL;
+        arg.ts = reinterpret_cast<uint64_t>(&ts);
+    }
+    return sysIoUringEnter(ringFd_, toSubmit, minComplete, flags | IORING_ENTER_EXT_ARG, &arg, sizeof arg);
+}
+
+// 取一个空闲的SQE，SQ满了就先把攒着的请求提交掉
+io_uring_sqe* IoUringPoller::getSqe()
+{
+    unsigned tail = *sqTail_;
+    unsigned head = __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE);
+    while (tail - head >= sqEntries_)
+    {
+        int ret = enter(toSubmit_, 0, 0, -1);
+        if (ret < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY)
+        {
+            LOG_FATAL("io_uring_enter submit error : %d \n", errno);
+        }
+        if (ret > 0)
+        {
+            toSubmit_ -= ret;
+        }
+        head = __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE);
+    }
+
+    unsigned index = tail & sqMask_;
+    struct io_uring_sqe *sqe = &sqes_[index];
+    memset(sqe, 0, sizeof *sqe);
+    sqArray_[index] = index;
+    __atomic_store_n(sqTail_, tail + 1, __ATOMIC_RELEASE);
+    ++toSubmit_;
+    return sqe;
+}
+
+IoUringPoller::PollState& IoUringPoller::stateOf(int fd)
+{
+    if (static_cast<size_t>(fd) >= states_.size())
+    {
+        states_.resize(fd + 1);
+    }
+    return states_[fd];
+}
+
+// 只是放进SQ，下一次poll的时候才一起提交
+void IoUringPoller::armPoll(int fd, int events)
+{
+    PollState &state = stateOf(fd);
+    ++state.generation;
+    state.armed = true;
+
+    struct io_uring_sqe *sqe = getSqe();
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = fd;
+    // EPOLLIN/EPOLLPRI/EPOLLOUT/EPOLLERR/EPOLLHUP 和 POLLXXX 的取值相同；EPOLLET之类的高位标志poll模式用不上
+    sqe->poll32_events = static_cast<uint32_t>(events) & 0xffff;
+    sqe->user_data = encodeUserData(fd, state.generation);
+}
+
+void IoUringPoller::cancelPoll(int fd)
+{
+    PollState &state = stateOf(fd);
+    if (!state.armed)
+    {
+        return;
+    }
+    struct io_uring_sqe *sqe = getSqe();
+    sqe->opcode = IORING_OP_POLL_REMOVE;
+    sqe->fd = -1;
+    sqe->addr = encodeUserData(fd, state.generation);
+    sqe->user_data = kIgnoreUserData;
+
+    ++state.generation; // 已经在CQ里的、属于旧请求的完成事件都会被丢弃
+    state.armed = false;
+}
+
+Timestamp IoUringPoller::poll(int timeoutMs, ChannelList *activeChannels)
+{
+    LOG_TRACE("func = %s => fd total count = %lu", __FUNCTION__, numChannels());
+
+    // 上一轮返回过事件的fd，如果还注册着就重新挂上poll（LT语义）
+    for (int fd : rearmFds_)
+    {
+        Channel *channel = findChannel(fd);
+        if (channel && channel->index() == kAdded
+            && !channel->isNoneEvent() && !stateOf(fd).armed)
+        {
+            armPoll(fd, channel->events());
+        }
+    }
+    rearmFds_.clear();
+
+    // 提交攒着的所有请求，同时等待至少一个完成事件：一次系统调用
+    int ret = enter(toSubmit_, 1, IORING_ENTER_GETEVENTS, timeoutMs);
+    int saveErrno = errno;
+    Timestamp now(Timestamp::now());
+    if (ret >= 0)
+    {
+        toSubmit_ -= ret;
+    }
+    else if (saveErrno != ETIME && saveErrno != EINTR)
+    {
+        errno = saveErrno;
+        LOG_ERROR("IoUringPoller::poll() error : %d", saveErrno);
+    }
+
+    int numEvents = reapCompletions(activeChannels);
+    // CQ满的时候内核把多出来的完成事件挂在溢出链表上，不取走的话那些fd的poll永远不会重新挂上
+    // 不带超时再进一次内核，把溢出的事件刷到CQ里，直到溢出标志清掉
+    while (__atomic_load_n(sqFlags_, __ATOMIC_ACQUIRE) & IORING_SQ_CQ_OVERFLOW)
+    {
+        if (enter(0, 0, IORING_ENTER_GETEVENTS, 0) < 0 && errno != EINTR && errno != ETIME && errno != EBUSY)
+        {
+            LOG_ERROR("IoUringPoller::poll() flush overflow error : %d", errno);
+            break;
+        }
+        numEvents += reapCompletions(activeChannels);
+    }
+
+    if (numEvents > 0)
+    {
+        LOG_TRACE("%d events happened !", numEvents);
+    }
+    return now;
+}
+
+// 取走CQ里现有的完成事件，返回其中有效的事件数
+int IoUringPoller::reapCompletions(ChannelList *activeChannels)
+{
+    unsigned head = *cqHead_;
+    unsigned tail = __atomic_load_n(cqTail_, __ATOMIC_ACQUIRE);
+    int numEvents = 0;
+    for (; head != tail; ++head)
+    {
+        const struct io_uring_cqe *cqe = &cqes_[head & cqMask_];
+        if (cqe->user_data == kIgnoreUserData)
+        {
+            continue;
+        }
+        int fd = static_cast<int>(cqe->user_data & 0xffffffff);
+        uint32_t generation = static_cast<uint32_t>(cqe->user_data >> 32);
+        if (static_cast<size_t>(fd) >= states_.size()
+            || states_[fd].generation != generation
+            || !states_[fd].armed)
+        {
+            continue; // 已经被取消或者修改过的旧请求
+        }
+        states_[fd].armed = false;
+
+        Channel *channel = findChannel(fd);
+        if (channel == nullptr)
+        {
+            continue;
+        }
+        channel->set_revents(cqe->res >= 0 ? cqe->res : static_cast<int>(EPOLLERR));
+        activeChannels->push_back(channel);
+        rearmFds_.push_back(fd);
+        ++numEvents;
+    }
+    __atomic_store_n(cqHead_, head, __ATOMIC_RELEASE);
+    return numEvents;
+}
+
+void IoUringPoller::updateChannel(Channel *channel)
+{
+    const int index = channel->index();
+    const int fd = channel->fd();
+    LOG_TRACE("func = %s => fd= %d events=%d index=%d", __FUNCTION__, fd, channel->events(), index);
+
+    // poll模式做不到边缘触发：清掉标志，TcpConnection看到的就是LT，走LT的读写路径
+    if (channel->edgeTriggered())
+    {
+        if (!warnedEdgeTriggered_)
+        {
+            warnedEdgeTriggered_ = true;
+            LOG_ERROR("IoUringPoller does not support edge-triggered mode, fd=%d falls back to level-triggered", fd);
+        }
+        channel->setEdgeTriggered(false);
+    }
+
+    if (index == kNew || index == kDeleted)
+    {
+        if (index == kNew)
+        {
+            addChannel(channel);
+        }
+        channel->set_index(kAdded);
+        cancelPoll(fd);
+        if (!channel->isNoneEvent())
+        {
+            armPoll(fd, channel->events());
+        }
+    }
+    else
+    {
+        // 感兴趣的事件变了：取消旧的poll，按新的事件重新挂
+        cancelPoll(fd);
+        if (channel->isNoneEvent())
+        {
+            channel->set_index(kDeleted);
+        }
+        else
+        {
+            armPoll(fd, channel->events());
+        }
+    }
+}
+
+void IoUringPoller::removeChannel(Channel *channel)
+{
+    int fd = channel->fd();
+    eraseChannel(fd);
+
+    LOG_TRACE("func = %s => fd= %d events=%d index=%d", __FUNCTION__, fd, channel->events(), channel->index());
+
+    cancelPoll(fd);
+    channel->set_index(kNew);
+}
+
+#else // 编译环境的头文件太旧，没有io_uring
+
+bool IoUringPoller::isSupported()
+{
+    return false;
+}
+
+IoUringPoller::IoUringPoller(EventLoop *loop)
+    : Poller(loop)
+{
+    LOG_FATAL("io_uring is not available in this build \n");
+}
+
+IoUringPoller::~IoUringPoller()
+{
+}
+
+Timestamp IoUringPoller::poll(int, ChannelList*)
+{
+    return Timestamp::now();
+}
+
+void IoUringPoller::updateChannel(Channel*)
+{
+}
+
+void IoUringPoller::removeChannel(Channel*)
+{
+}
+
+#endif
@@ -0,0 +1,85 @@
+#pragma once
+
+#include "Poller.h"
+#include "Timestamp.h"
+
+#include <vector>
+#include <stdint.h>
+#include <stddef.h>
+
+class Channel;
+struct io_uring_sqe;
+struct io_uring_cqe;
+
+/**
+ * 基于io_uring的Poller，只实现了poll模式：和EPollPoller一样是LT语义，只是把epoll_ctl/epoll_wait换成了io_uring的请求
+ * 不支持边缘触发：注册时会把Channel的边缘触发标志清掉（打一条错误日志），TcpConnection据此走LT的读写路径
+ * 完成模式（多次触发的accept、provided buffer ring直接收数据、sendInLoop的写请求批量提交）没有实现，读写仍然是read/write系统调用
+ * 所以每个请求的系统调用数和epoll一样：benchmark/uring_bench 里16个连接pingpong，两种后端都是每个请求一次readv、一次write，
+ * 等待就绪的系统调用被同一轮的多个连接分摊（约0.07次/请求）；要减少系统调用只能把读写放进SQ，那是完成模式的工作
+ *
+ * 每个感兴趣的fd挂一个一次性的IORING_OP_POLL_ADD，完成以后在下一次poll时重新挂上（重新挂的时候内核会立即检查就绪状态，所以还是水平触发）
+ * 和epoll的区别在于：epoll_ctl的增删改、上一轮就绪fd的重新挂载，全部攒在提交队列里，和等待事件合并成一次io_uring_enter
+ *
+ * 直接用io_uring_setup/io_uring_enter系统调用，不依赖liburing；需要内核 >= 5.11（IORING_FEAT_EXT_ARG，等待时带超时）
+ * 不支持时 Poller::newPoller 会退回到epoll
+ */
+class IoUringPoller : public Poller
+{
+public:
+    IoUringPoller(EventLoop *loop);
+    ~IoUringPoller() override;
+
+    Timestamp poll(int timeoutMs, ChannelList *activeChannels) override;
+    void updateChannel(Channel *channel) override;
+    void removeChannel(Channel *channel) override;
+
+    // 当前内核/头文件是否支持，只探测一次
+    static bool isSupported();
+
+private:
+    static const unsigned kRingEntries = 256;
+    static const unsigned kCqEntries = kRingEntries * 16;
+
+    // 每个fd当前挂着的poll请求的状态
+    struct PollState
+    {
+        PollState() : generation(0), armed(false) {}
+        uint32_t generation; // 每次挂载/取消都加一，编码在user_data里，用来丢弃过期的完成事件
+        bool armed;
+    };
+
+    io_uring_sqe* getSqe();
+    int enter(unsigned toSubmit, unsigned minComplete, unsigned flags, int timeoutMs);
+    void armPoll(int fd, int events);
+    void cancelPoll(int fd);
+    PollState& stateOf(int fd);
+    int reapCompletions(ChannelList *activeChannels);
+
+    int ringFd_;
+
+    // 提交队列（SQ）
+    void *sqRing_;
+    size_t sqRingSize_;
+    unsigned *sqHead_;
+    unsigned *sqTail_;
+    unsigned sqMask_;
+    unsigned sqEntries_;
+    unsigned *sqArray_;
+    io_uring_sqe *sqes_;
+    size_t sqesSize_;
+    unsigned *sqFlags_; // IORING_SQ_CQ_OVERFLOW：CQ满了，有完成事件暂存在内核里
+    unsigned toSubmit_; // 已经放进SQ还没有提交给内核的请求数
+
+    // 完成队列（CQ）
+    void *cqRing_;
+    size_t cqRingSize_;
+    unsigned *cqHead_;
+    unsigned *cqTail_;
+    unsigned cqMask_;
+    io_uring_cqe *cqes_;
+
+    std::vector<PollState> states_; // 按fd下标
+    std::vector<int> rearmFds_; // 上一轮返回了事件、需要重新挂poll的fd
+    bool warnedEdgeTriggered_; // 边缘触发的错误日志只打一次
+};
@@ -0,0 +1,164 @@
+#include "LogFile.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+
+LogFile::LogFile(const std::string &basename, off_t rollSize)
+    : basename_(basename)
+    , rollSize_(rollSize)
+    , fd_(-1)
+    , writtenBytes_(0)
+    , startOfPeriod_(0)
+    , lastRoll_(0)
+{
+    rollFile();
+}
+
+LogFile::~LogFile()
+{
+    if (fd_ >= 0)
+    {
+        ::close(fd_);
+    }
+}
+
+void LogFile::append(const char *logline, size_t len)
+{
+    struct iovec vec;
+    vec.iov_base = const_cast<char*>(logline);
+    vec.iov_len = len;
+    appendv(&vec, 1);
+}
+
+void LogFile::appendv(const struct iovec *iov, int iovcnt)
+{
+    while (iovcnt > 0)
+    {
+        int cnt = iovcnt < IOV_MAX ? iovcnt : IOV_MAX;
+        size_t total = 0;
+        for (int i = 0; i < cnt; ++i)
+        {
+            total += iov[i].iov_len;
+        }
+
+        ssize_t n = ::writev(fd_, iov, cnt);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            fprintf(stderr, "LogFile::appendv() failed %s\n", strerror(errno));
+            return; // 日志写不进去也不能影响业务，丢掉这一批
+        }
+        writtenBytes_ += n;
+
+        if (static_cast<size_t>(n) < total) // 部分写入，剩下的逐段补写
+        {
+            size_t skip = n;
+            for (int i = 0; i < cnt; ++i)
+            {
+                const char *base = static_cast<const char*>(iov[i].iov_base);
+                size_t len = iov[i].iov_len;
+                if (skip >= len)
+                {
+                    skip -= len;
+                    continue;
+                }
+                base += skip;
+                len -= skip;
+                skip = 0;
+                while (len > 0)
+                {
+                    ssize_t m = ::write(fd_, base, len);
+                    if (m < 0 && errno == EINTR)
+                    {
+                        continue;
+                    }
+                    if (m <= 0)
+                    {
+                        return;
+                    }
+                    writtenBytes_ += m;
+                    base += m;
+                    len -= m;
+                }
+            }
+        }
+
+        iov += cnt;
+        iovcnt -= cnt;
+    }
+
+    checkRoll(::time(NULL));
+}
+
+void LogFile::checkRoll(time_t now)
+{
+    if (writtenBytes_ > rollSize_)
+    {
+        rollFile();
+    }
+    else if (now / kRollPerSeconds_ * kRollPerSeconds_ != startOfPeriod_) // 跨天了
+    {
+        rollFile();
+    }
+}
+
+bool LogFile::rollFile()
+{
+    time_t now = ::time(NULL);
+    if (now <= lastRoll_)
+    {
+        return false;
+    }
+
+    std::string filename = getLogFileName(basename_, now);
+    int fd = ::open(filename.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (fd < 0)
+    {
+        fprintf(stderr, "LogFile::rollFile() open %s failed %s\n", filename.c_str(), strerror(errno));
+        return false;
+    }
+    if (fd_ >= 0)
+    {
+        ::close(fd_);
+    }
+    fd_ = fd;
+    writtenBytes_ = 0;
+    lastRoll_ = now;
+    startOfPeriod_ = now / kRollPerSeconds_ * kRollPerSeconds_;
+    return true;
+}
+
+// basename.20240101-120000.hostname.pid.log
+std::string LogFile::getLogFileName(const std::string &basename, time_t now)
+{
+    std::string filename(basename);
+
+    char timebuf[32];
+    struct tm tm;
+    ::localtime_r(&now, &tm);
+    strftime(timebuf, sizeof timebuf, ".%Y%m%d-%H%M%S.", &tm);
+    filename += timebuf;
+
+    char hostname[256] = {0};
+    if (::gethostname(hostname, sizeof hostname - 1) == 0)
+    {
+        filename += hostname;
+    }
+    else
+    {
+        filename += "unknownhost";
+    }
+
+    char pidbuf[32];
+    snprintf(pidbuf, sizeof pidbuf, ".%d.log", ::getpid());
+    filename += pidbuf;
+
+    return filename;
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "noncopyable.h"
+
+#include <string>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <time.h>
+
+// 滚动日志文件：写满rollSize字节或者跨天就换一个新文件
+// 直接用write/writev写fd，不经过stdio缓冲，只给AsyncLogging的后台线程使用（非线程安全）
+class LogFile : noncopyable
+{
+public:
+    LogFile(const std::string &basename, off_t rollSize);
+    ~LogFile();
+
+    void append(const char *logline, size_t len);
+    // 一次writev写出一批缓冲区，减少系统调用次数
+    void appendv(const struct iovec *iov, int iovcnt);
+
+    bool rollFile();
+
+private:
+    void checkRoll(time_t now);
+    static std::string getLogFileName(const std::string &basename, time_t now);
+
+    const std::string basename_;
+    const off_t rollSize_;
+
+    int fd_;
+    off_t writtenBytes_;  // 当前文件已经写了多少字节
+    time_t startOfPeriod_; // 当前文件所属的那一天（按天对齐的秒数）
+    time_t lastRoll_;      // 上一次滚动的时间，同一秒内不重复滚动（文件名会重复）
+
+    static const int kRollPerSeconds_ = 60 * 60 * 24;
+};
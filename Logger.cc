@@ -1,42 +1,105 @@
 #include "Logger.h"
-#include "Timestamp.h"
- 
-#include <iostream>
- 
+
+#include <time.h>
+#include <string.h>
+#include <unistd.h>
+
+namespace
+{
+    //每个线程缓存上一次格式化的秒数和时间字符串，同一秒内的日志不用再调用localtime_r
+    __thread time_t t_lastSecond = 0;
+    __thread char t_time[64]; // 按int的最大位数留够，snprintf不会截断
+
+    const int kMaxMsgSize = 1024; // 宏里面的消息缓冲区
+    const int kMaxLineSize = kMaxMsgSize + 128; // 128留给级别、时间和换行，t_time最长63字节
+
+    const char* const kLevelName[] = {
+        "[TRACE]",
+        "[DEBUG]",
+        "[INFO]",
+        "[ERROR]",
+        "[FATAL]",
+    };
+
+    //默认输出：直接write到stdout，一行一次系统调用，和原来 std::endl 每行刷新的效果一致
+    void defaultOutput(const char *msg, size_t len)
+    {
+        size_t written = 0;
+        while (written < len)
+        {
+            ssize_t n = ::write(STDOUT_FILENO, msg + written, len - written);
+            if (n <= 0)
+            {
+                break;
+            }
+            written += n;
+        }
+    }
+
+    void defaultFlush()
+    {
+    }
+}
+
+std::atomic_int Logger::logLevel_(INFO);
+
+Logger::Logger()
+    : output_(defaultOutput)
+    , flush_(defaultFlush)
+{
+}
+
 //获取日志唯一的实例对象
 Logger& Logger::instance()
 {
     static Logger logger;
     return logger;
 }
- 
-//设置日志级别
-void Logger::setLogLevel(int level)
-{
-    logLevel_ = level;
-}
- 
-//写日志  [级别信息] time : msg
-void Logger::log(std::string msg)
+
+//写日志  [级别信息]time : msg
+//整行先在栈上拼好，再一次交给output_，多个线程同时写日志也不会交错
+void Logger::log(int level, const char *msg, int len)
 {
-    switch (logLevel_)
+    time_t now = ::time(NULL);
+    if (now != t_lastSecond)
     {
-    case INFO:
-        std::cout << "[INFO]";
-        break;
-    case ERROR:
-        std::cout << "[ERROR]";
-        break;
-    case FATAL:
-        std::cout << "[FATAL]";
-        break;
-    case DEBUG:
-        std::cout << "[DEBUG]";
-        break;
-    default:
-        break;
+        t_lastSecond = now;
+        struct tm tm_time;
+        ::localtime_r(&now, &tm_time);
+        snprintf(t_time, sizeof t_time, "%4d/%02d/%02d %02d:%02d:%02d",
+            tm_time.tm_year + 1900,
+            tm_time.tm_mon + 1,
+            tm_time.tm_mday,
+            tm_time.tm_hour,
+            tm_time.tm_min,
+            tm_time.tm_sec);
     }
- 
-    //打印时间和msg
-    std::cout << Timestamp::now().toString() << " : " << msg << std::endl;
-}
\ No newline at end of file
+
+    if (len < 0)
+    {
+        len = 0;
+    }
+    else if (len >= kMaxMsgSize) // 等于1024时snprintf也截断了，最后一个字节是'\0'
+    {
+        len = kMaxMsgSize - 1; // snprintf 截断了，只有缓冲区里的那部分是有效的
+    }
+
+    char line[kMaxLineSize];
+    const char *levelName = (level >= TRACE && level <= FATAL) ? kLevelName[level] : "";
+    int n = snprintf(line, sizeof line, "%s%s : ", levelName, t_time);
+    memcpy(line + n, msg, len);
+    n += len;
+    line[n++] = '\n';
+
+    output_(line, n);
+
+    if (level == FATAL)
+    {
+        flush(); // 马上就要exit了，后台线程缓存的日志要先写出去
+    }
+}
+
+void Logger::flush()
+{
+    flush_();
+}
@@ -1,77 +1,94 @@
 #pragma once
- 
+
 #include <string>
- 
+#include <atomic>
+#include <functional>
+#include <stdio.h>
+#include <stdlib.h>
+
 #include "noncopyable.h"
- 
+
+//编译期的日志级别下限，低于它的LOG_XXX调用在编译时就被优化掉，连参数都不会求值
+//默认只保留INFO及以上；定义MUDEBUG时打开TRACE和DEBUG，也可以直接 -DMUDUO_LOG_MIN_LEVEL=ERROR
+#ifndef MUDUO_LOG_MIN_LEVEL
+#ifdef MUDEBUG
+#define MUDUO_LOG_MIN_LEVEL TRACE
+#else
+#define MUDUO_LOG_MIN_LEVEL INFO
+#endif
+#endif
+
 //LOG_INFO("%s %d", arg1, arg2)
 //__VA_ARGS__获取可变参的宏
 //logmsgFormat：字符串，后面...是可变参
-#define LOG_INFO(logmsgFormat, ...) \
+//先比较级别再格式化：被过滤掉的日志只付出一次原子读（编译期下限以下的连这一次都没有）
+//日志级别作为参数直接传给log，不再先setLogLevel再log（两步之间会被其他线程改掉级别）
+#define LOG_BASE(level, logmsgFormat, ...) \
     do \
     { \
-        Logger &logger = Logger::instance(); \
-        logger.setLogLevel(INFO); \
-        char buf[1024] = {0}; \
-        snprintf(buf, 1024, logmsgFormat, ##__VA_ARGS__); \
-        logger.log(buf); \
-    } while(0) 
- 
-#define LOG_ERROR(logmsgFormat, ...) \
-    do \
-    { \
-        Logger &logger = Logger::instance(); \
-        logger.setLogLevel(ERROR); \
-        char buf[1024] = {0}; \
-        snprintf(buf, 1024, logmsgFormat, ##__VA_ARGS__); \
-        logger.log(buf); \
-    } while(0) 
- 
+        if (level >= MUDUO_LOG_MIN_LEVEL && level >= Logger::logLevel()) \
+        { \
+            char buf[1024]; \
+            int len = snprintf(buf, sizeof buf, logmsgFormat, ##__VA_ARGS__); \
+            Logger::instance().log(level, buf, len); \
+        } \
+    } while(0)
+
+#define LOG_TRACE(logmsgFormat, ...) LOG_BASE(TRACE, logmsgFormat, ##__VA_ARGS__)
+#define LOG_DEBUG(logmsgFormat, ...) LOG_BASE(DEBUG, logmsgFormat, ##__VA_ARGS__)
+#define LOG_INFO(logmsgFormat, ...) LOG_BASE(INFO, logmsgFormat, ##__VA_ARGS__)
+#define LOG_ERROR(logmsgFormat, ...) LOG_BASE(ERROR, logmsgFormat, ##__VA_ARGS__)
+
+//FATAL不受级别过滤，一定会输出并退出
 #define LOG_FATAL(logmsgFormat, ...) \
     do \
     { \
-        Logger &logger = Logger::instance(); \
-        logger.setLogLevel(FATAL); \
-        char buf[1024] = {0}; \
-        snprintf(buf, 1024, logmsgFormat, ##__VA_ARGS__); \
-        logger.log(buf); \
+        char buf[1024]; \
+        int len = snprintf(buf, sizeof buf, logmsgFormat, ##__VA_ARGS__); \
+        Logger::instance().log(FATAL, buf, len); \
         exit(-1); \
-    } while(0) 
- 
-#ifdef MUDEBUG
-#define LOG_DEBUG(logmsgFormat, ...) \
-    do \
-    { \
-        Logger &logger = Logger::instance(); \
-        logger.setLogLevel(DEBUG); \
-        char buf[1024] = {0}; \
-        snprintf(buf, 1024, logmsgFormat, ##__VA_ARGS__); \
-        logger.log(buf); \
-    } while(0) 
-#else
-    #define LOG_DEBUG(logmsgFormat, ...)
-#endif
- 
-//定义日志的级别  INFO（正常的日志输出）  ERROR（错误，不影响软件继续向下执行）
-//  FATAL（毁灭性的打击，系统无法正常向下运行）  DEBUG（调试信息，一般是关闭的） 
+    } while(0)
+
+//定义日志的级别，按严重程度从低到高排列，级别过滤直接比较大小
+//  TRACE（每个事件都打印的跟踪信息）  DEBUG（调试信息，一般是关闭的）  INFO（正常的日志输出）
+//  ERROR（错误，不影响软件继续向下执行）  FATAL（毁灭性的打击，系统无法正常向下运行）
 enum LogLevel
 {
+    TRACE,//跟踪信息
+    DEBUG,//调试信息
     INFO, //普通信息
     ERROR,//错误信息
     FATAL,//core信息
-    DEBUG,//调试信息
 };
- 
+
 //输出一个日志类
+//默认同步写到stdout；调用setOutput/setFlush可以把输出交给AsyncLogging后台线程
 class Logger : noncopyable
 {
 public:
+    using OutputFunc = std::function<void(const char *msg, size_t len)>;
+    using FlushFunc = std::function<void()>;
+
     //获取日志唯一的实例对象
     static Logger& instance();
-    //设置日志级别
-    void setLogLevel(int level);
-    //写日志
-    void log(std::string msg);
+    //写日志  len是snprintf的返回值，超过缓冲区时会被截断
+    void log(int level, const char *msg, int len);
+
+    //设置日志的输出位置和刷新方式，只能在启动各个EventLoop线程之前调用
+    void setOutput(OutputFunc out) { output_ = std::move(out); }
+    void setFlush(FlushFunc flush) { flush_ = std::move(flush); }
+    //把已经缓存的日志全部写出去，FATAL退出前会调用
+    void flush();
+
+    //运行期的日志级别，低于它的日志在宏里就被过滤掉，任何线程都可以随时修改
+    static int logLevel() { return logLevel_.load(std::memory_order_relaxed); }
+    static void setLogLevel(int level) { logLevel_.store(level, std::memory_order_relaxed); }
+
 private:
-    int logLevel_;
-};
\ No newline at end of file
+    Logger();
+
+    static std::atomic_int logLevel_;
+
+    OutputFunc output_;
+    FlushFunc flush_;
+};
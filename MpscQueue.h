@@ -0,0 +1,191 @@
+#pragma once
+
+#include "noncopyable.h"
+
+#include <atomic>
+#include <mutex>
+#include <new>
+#include <stddef.h>
+#include <utility>
+#include <type_traits>
+
+/**
+ * 无锁的多生产者/单消费者队列，给EventLoop的pendingFunctors用
+ *
+ * 生产者：把结点CAS压到head_上（Treiber栈），任何线程都可以push，不加锁
+ * 消费者：只有loop线程，一次exchange(nullptr)把整批结点摘下来，反转成先进先出再依次执行
+ *        这和原来在锁里swap整个vector的语义一样：执行期间新push进来的留到下一轮
+ * 消费者只做"整批摘走"，不会单独弹出某个结点，所以不存在ABA问题
+ *
+ * 结点用完以后不delete，整批还给同类型的全局空闲链表（最多缓存kMaxFree个，多的直接释放）
+ * 生产者线程每次从空闲链表取最多kCacheBatch个到自己的线程局部缓存里，一个线程囤不了所有结点
+ * 空闲链表只在取一批/还一批时加一次锁，稳定运行以后push不再分配内存
+ * 线程退出时释放它缓存的结点，程序退出时释放空闲链表，队列析构时释放还没执行的结点
+ */
+template <typename T>
+class MpscQueue : noncopyable
+{
+public:
+    MpscQueue() : head_(nullptr) {}
+
+    ~MpscQueue()
+    {
+        Node *node = head_.exchange(nullptr, std::memory_order_acquire);
+        while (node)
+        {
+            Node *next = node->next;
+            node->value()->~T();
+            delete node;
+            node = next;
+        }
+    }
+
+    // 任何线程都可以调用
+    void push(T value)
+    {
+        Node *node = allocNode();
+        new (node->storage) T(std::move(value));
+        Node *old = head_.load(std::memory_order_relaxed);
+        do
+        {
+            node->next = old;
+        } while (!head_.compare_exchange_weak(old, node,
+                    std::memory_order_release, std::memory_order_relaxed));
+    }
+
+    // 只有消费者线程可以调用：取走当前所有元素，按push的顺序逐个交给func，返回处理的个数
+    template <typename Func>
+    size_t consumeAll(Func &&func)
+    {
+        Node *node = head_.exchange(nullptr, std::memory_order_acquire);
+        if (node == nullptr)
+        {
+            return 0;
+        }
+
+        // 栈是后进先出的，反转一下
+        Node *fifo = nullptr;
+        while (node)
+        {
+            Node *next = node->next;
+            node->next = fifo;
+            fifo = node;
+            node = next;
+        }
+
+        size_t count = 0;
+        for (Node *it = fifo; it != nullptr; it = it->next)
+        {
+            func(*it->value());
+            it->value()->~T();
+            ++count;
+        }
+        freeList().recycle(fifo); // 整条链一次还回去
+        return count;
+    }
+
+    bool empty() const { return head_.load(std::memory_order_acquire) == nullptr; }
+
+private:
+    struct Node
+    {
+        typename std::aligned_storage<sizeof(T), alignof(T)>::type storage[1];
+        Node *next;
+
+        T* value() { return reinterpret_cast<T*>(storage); }
+    };
+
+    static const size_t kCacheBatch = 64; // 生产者一次从空闲链表取多少个
+    static const size_t kMaxFree = 16384; // 空闲链表最多缓存多少个
+
+    static void deleteList(Node *node)
+    {
+        while (node)
+        {
+            Node *next = node->next;
+            delete node;
+            node = next;
+        }
+    }
+
+    // 同一种T的所有队列共用一个空闲链表，结点被哪个生产者拿走都可以
+    struct FreeList
+    {
+        std::mutex mutex;
+        Node *head = nullptr;
+        size_t size = 0;
+
+        ~FreeList() { deleteList(head); }
+
+        // 摘下最多kCacheBatch个
+        Node* take()
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            Node *first = head;
+            Node *last = nullptr;
+            size_t n = 0;
+            for (Node *it = head; it != nullptr && n < kCacheBatch; it = it->next)
+            {
+                last = it;
+                ++n;
+            }
+            if (last)
+            {
+                head = last->next;
+                last->next = nullptr;
+                size -= n;
+            }
+            return first;
+        }
+
+        // 以nullptr结尾的一条链，放不下的部分在锁外释放
+        void recycle(Node *chain)
+        {
+            Node *overflow = nullptr;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                while (chain && size < kMaxFree)
+                {
+                    Node *next = chain->next;
+                    chain->next = head;
+                    head = chain;
+                    ++size;
+                    chain = next;
+                }
+                overflow = chain;
+            }
+            deleteList(overflow);
+        }
+    };
+
+    static FreeList& freeList()
+    {
+        static FreeList list;
+        return list;
+    }
+
+    // 生产者线程局部的结点缓存，最多kCacheBatch个，线程退出时释放
+    struct NodeCache
+    {
+        Node *head = nullptr;
+        ~NodeCache() { deleteList(head); }
+    };
+
+    static Node* allocNode()
+    {
+        static thread_local NodeCache cache;
+        if (cache.head == nullptr)
+        {
+            cache.head = freeList().take();
+            if (cache.head == nullptr)
+            {
+                return new Node;
+            }
+        }
+        Node *node = cache.head;
+        cache.head = node->next;
+        return node;
+    }
+
+    std::atomic<Node*> head_;
+};
@@ -1,15 +1,41 @@
 #include "Poller.h"
 #include "Channel.h"
 
+#include <algorithm>
+
 Poller::Poller(EventLoop *loop)
-    : ownerLoop_(loop)
+    : numChannels_(0)
+    , ownerLoop_(loop)
 {
 }
 
 bool Poller::hasChannel(Channel *channel) const
 {
-    auto it = channels_.find(channel->fd());  // channels_是ChannelMap
-    return it != channels_.end() && it->second == channel;
+    return findChannel(channel->fd()) == channel;
+}
+
+void Poller::addChannel(Channel *channel)
+{
+    const size_t fd = channel->fd();
+    if (fd >= channels_.size())
+    {
+        // 成倍扩容，fd一个一个往上涨的时候不用每次都resize
+        channels_.resize(std::max(fd + 1, channels_.size() * 2), nullptr);
+    }
+    if (channels_[fd] == nullptr)
+    {
+        ++numChannels_;
+    }
+    channels_[fd] = channel;
+}
+
+void Poller::eraseChannel(int fd)
+{
+    if (static_cast<size_t>(fd) < channels_.size() && channels_[fd] != nullptr)
+    {
+        channels_[fd] = nullptr;
+        --numChannels_;
+    }
 }
 
 // 下面语法上没问题，但这个函数要生成具体的IO对象，并返回一个基类的指针。所以一定要包含 #include "PollPoller.h" #include "EpollPoller" 这几个Poller的派生类
@@ -4,7 +4,6 @@
 #include "Timestamp.h"
 
 #include <vector>
-#include <unordered_map>
 
 class Channel;
 class EventLoop;
@@ -15,6 +14,14 @@ class Poller
 public:
     using ChannelList = std::vector<Channel*>;
 
+    // 底层IO复用的实现
+    enum Backend
+    {
+        kDefault, // 看环境变量：设置了MUDUO_USE_IOURING就用io_uring，否则用epoll
+        kEPoll,
+        kIoUring, // 内核不支持时退回到epoll
+    };
+
     Poller(EventLoop *loop); //构造函数
     virtual ~Poller() = default;
 
@@ -29,13 +36,24 @@ public:
     bool hasChannel(Channel *channel) const;
 
     // EventLoop事件循环可以通过该接口获取默认的IO复用的具体实现
-    static Poller* newDefaultPoller(EventLoop *loop);
+    static Poller* newDefaultPoller(EventLoop *loop, Backend backend = kDefault);
 
 protected:
-    // map的key表示：sockfd，value表示sockfd所属的Channel（通道类型）
-    using ChannelMap = std::unordered_map<int, Channel*>;
+    // 下标是sockfd，值是sockfd所属的Channel（通道类型），没有注册的fd是nullptr
+    // fd是内核从小往大分配的小整数，直接用数组下标查找，不用哈希，增删连接时也不用分配节点
+    using ChannelMap = std::vector<Channel*>;
+
+    Channel* findChannel(int fd) const
+    {
+        return static_cast<size_t>(fd) < channels_.size() ? channels_[fd] : nullptr;
+    }
+    void addChannel(Channel *channel); // 按需扩容
+    void eraseChannel(int fd);
+    size_t numChannels() const { return numChannels_; }
+
     ChannelMap channels_;
 
 private:
+    size_t numChannels_; // channels_里非空的个数
     EventLoop *ownerLoop_; // 定义Poller所属的事件循环EventLoop
 };
\ No newline at end of file
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "SlabPool.h"
+
+#include <memory>
+#include <new>
+#include <stddef.h>
+
+/**
+ * 从SlabPool分配内存的标准分配器，给std::allocate_shared用
+ * allocate_shared把控制块和对象放在同一块内存里，再从池子里取这块内存：
+ * 稳定运行以后创建/销毁一个对象不再调用malloc/free
+ * 要的大小超过slabSize时退回到operator new，所以池子的块大小估小了也只是不走池子，不会出错
+ * 控制块里保存着一份分配器（也就是池子的shared_ptr），池子一定活得比从它分出去的对象久
+ */
+template <typename T>
+class PoolAllocator
+{
+public:
+    using value_type = T;
+
+    explicit PoolAllocator(std::shared_ptr<SlabPool> pool) : pool_(std::move(pool)) {}
+
+    template <typename U>
+    PoolAllocator(const PoolAllocator<U> &other) : pool_(other.pool()) {}
+
+    T* allocate(size_t n)
+    {
+        if (n * sizeof(T) <= pool_->slabSize())
+        {
+            return static_cast<T*>(static_cast<void*>(pool_->allocate()));
+        }
+        return static_cast<T*>(::operator new(n * sizeof(T)));
+    }
+
+    void deallocate(T *p, size_t n)
+    {
+        if (n * sizeof(T) <= pool_->slabSize())
+        {
+            pool_->deallocate(static_cast<char*>(static_cast<void*>(p)));
+        }
+        else
+        {
+            ::operator delete(p);
+        }
+    }
+
+    const std::shared_ptr<SlabPool>& pool() const { return pool_; }
+
+private:
+    std::shared_ptr<SlabPool> pool_;
+};
+
+template <typename T, typename U>
+bool operator==(const PoolAllocator<T> &lhs, const PoolAllocator<U> &rhs)
+{
+    return lhs.pool() == rhs.pool();
+}
+
+template <typename T, typename U>
+bool operator!=(const PoolAllocator<T> &lhs, const PoolAllocator<U> &rhs)
+{
+    return !(lhs == rhs);
+}
@@ -0,0 +1,48 @@
+#include "SlabPool.h"
+
+SlabPool::SlabPool(size_t slabSize, size_t maxFree)
+    : slabSize_(slabSize)
+    , maxFree_(maxFree)
+{
+}
+
+SlabPool::~SlabPool()
+{
+    for (char *slab : freeList_)
+    {
+        delete[] slab;
+    }
+}
+
+char* SlabPool::allocate()
+{
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (!freeList_.empty())
+        {
+            char *slab = freeList_.back();
+            freeList_.pop_back();
+            return slab;
+        }
+    }
+    return new char[slabSize_];
+}
+
+void SlabPool::deallocate(char *slab)
+{
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (freeList_.size() < maxFree_)
+        {
+            freeList_.push_back(slab);
+            return;
+        }
+    }
+    delete[] slab;
+}
+
+size_t SlabPool::freeCount() const
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    return freeList_.size();
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include "noncopyable.h"
+
+#include <mutex>
+#include <vector>
+#include <stddef.h>
+
+/**
+ * 固定大小内存块（slab）的池子，每个EventLoop一个，给ChainBuffer用
+ * 用完的slab放回空闲链表，下次直接复用；空闲链表最多缓存maxFree个，多出来的直接还给系统
+ * 连接一般在自己的loop线程里用，但TcpConnection可能在别的线程析构，所以加了一把（基本不会竞争的）锁
+ */
+class SlabPool : noncopyable
+{
+public:
+    static const size_t kDefaultSlabSize = 16 * 1024;
+    static const size_t kDefaultMaxFree = 256; // 每个loop最多缓存4M
+
+    explicit SlabPool(size_t slabSize = kDefaultSlabSize, size_t maxFree = kDefaultMaxFree);
+    ~SlabPool();
+
+    char* allocate();
+    void deallocate(char *slab);
+
+    size_t slabSize() const { return slabSize_; }
+    size_t freeCount() const;
+
+private:
+    const size_t slabSize_;
+    const size_t maxFree_;
+    mutable std::mutex mutex_;
+    std::vector<char*> freeList_;
+};
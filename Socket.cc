@@ -8,6 +8,10 @@
 #include <netinet/tcp.h>
 #include <strings.h>
 
+#ifndef SO_ZEROCOPY
+#define SO_ZEROCOPY 60 // 内核4.14以后才有
+#endif
+
 Socket::~Socket()
 {
     close(sockfd_);//调用系统的close
@@ -92,3 +96,9 @@ void Socket::setKeepAlive(bool on)//启动Tcp Socket的保活机制
     int optval = on ? 1 : 0;
     ::setsockopt(sockfd_, SOL_SOCKET, SO_KEEPALIVE, &optval, sizeof optval);
 }
+
+bool Socket::setZeroCopy(bool on)
+{
+    int optval = on ? 1 : 0;
+    return ::setsockopt(sockfd_, SOL_SOCKET, SO_ZEROCOPY, &optval, sizeof optval) == 0;
+}
@@ -23,6 +23,7 @@ public:
     void setReuseAddr(bool on); //地址重用
     void setReusePort(bool on); //端口重用
     void setKeepAlive(bool on);
+    bool setZeroCopy(bool on); //允许sendmsg带MSG_ZEROCOPY，内核不支持时返回false
 
 private:
     const int sockfd_;
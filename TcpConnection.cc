@@ -7,10 +7,14 @@
 
 #include <functional>
 #include <string> // 注意区分#include <string.h>
+#include <algorithm>
 #include <errno.h>
 #include <unistd.h>
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/sendfile.h>
+#include <fcntl.h>
 #include <netinet/tcp.h>
 
 static EventLoop* CheckLoopNotNull (EventLoop* loop)  // 防止不同文件函数名字冲突
@@ -26,76 +30,303 @@ TcpConnection::TcpConnection(EventLoop *loop,
                 int sockfd,
                 const InetAddress& localAddr,
                 const InetAddress& peerAddr)
+    : TcpConnection(loop, 0, std::make_shared<const std::string>(nameArg), sockfd, localAddr, peerAddr)
+{
+}
+
+TcpConnection::TcpConnection(EventLoop *loop,
+                uint64_t id,
+                const std::shared_ptr<const std::string> &namePrefix,
+                int sockfd,
+                const InetAddress& localAddr,
+                const InetAddress& peerAddr)
     : loop_(CheckLoopNotNull(loop))
-    , name_(nameArg)
+    , id_(id)
+    , namePrefix_(namePrefix)
     , state_(kConnecting)
     , reading_(true)
-    , socket_(new Socket(sockfd))
-    , channel_(new Channel(loop, sockfd)) // 设置一堆的callback 👇，就是为了Poller通知channel发生事件后，channel能够执行在TcpConnection预先设置的回调
+    , backpressured_(false)
+    , socket_(sockfd)
+    , channel_(loop, sockfd) // 设置一堆的callback 👇，就是为了Poller通知channel发生事件后，channel能够执行在TcpConnection预先设置的回调
     , localAddr_(localAddr)
     , peerAddr_(peerAddr)
     , highWaterMark_(64*1024*1024) // 水位线是64M，超过就要停止发送了（防止发送的太快，接受的太慢）
+    , readHighWaterMark_(0)
+    , readLowWaterMark_(0)
+    , idleTimeout_(0.0)
+    , ioBudget_(0)
+    , ioTimeBudget_(0.0)
+    , readExtraBufSize_(Buffer::kDefaultExtraBufSize)
+    , autoCork_(false)
+    , corked_(false)
+    , releaseIdleBuffers_(false)
+    , releaseIdleSeconds_(1.0)
+    , outputBuffer_(loop->slabPool())
 {   
     // 下面给channel设置相应的回调函数，poller给channel通知感兴趣的事件发生了，channel会回调相应的操作函数
-    channel_->setReadCallback(
+    channel_.setReadCallback(
         std::bind(&TcpConnection::handleRead, this, std::placeholders::_1)
     );
-    channel_->setWriteCallback(
+    channel_.setWriteCallback(
         std::bind(&TcpConnection::handleWrite, this)
     );
-    channel_->setCloseCallback(
+    channel_.setCloseCallback(
         std::bind(&TcpConnection::handleClose, this)
     );
-    channel_->setErrorCallback(
+    channel_.setErrorCallback(
         std::bind(&TcpConnection::handleError, this)
     );
 
-    LOG_INFO("TcpConnection::ctor[%s] at fd = %d\n", name_.c_str(), sockfd);
-    socket_->setKeepAlive(true);//启动Tcp Socket的保活机制
+    LOG_DEBUG("TcpConnection::ctor[%s] at fd = %d\n", name().c_str(), sockfd);
+    loop_->addConnections(1); // 在TcpServer选完loop马上计数，还没connectEstablished的连接也算这个loop的负载
+    socket_.setKeepAlive(true);//启动Tcp Socket的保活机制
 }
 
 TcpConnection::~TcpConnection()
 {
-    LOG_INFO("TcpConnection::dtor[%s] at fd = %d state=%d \n", name_.c_str(), channel_->fd(), int(state_));
+    LOG_DEBUG("TcpConnection::dtor[%s] at fd = %d state=%d \n", name().c_str(), channel_.fd(), int(state_));
+    loop_->addConnections(-1);
+}
+
+// 任何线程都可能调用（日志、用户回调），只格式化一次
+const std::string& TcpConnection::name() const
+{
+    std::call_once(nameOnce_, [this] {
+        name_ = id_ == 0 ? *namePrefix_ : *namePrefix_ + std::to_string(id_);
+    });
+    return name_;
+}
+
+
+void TcpConnection::setEdgeTriggered(bool on, size_t budgetBytes)
+{
+    channel_.setEdgeTriggered(on);
+    ioBudget_ = budgetBytes;
+}
+
+void TcpConnection::setZeroCopy(size_t thresholdBytes, std::shared_ptr<ZeroCopyStats> stats)
+{
+    if (thresholdBytes > 0 && !socket_.setZeroCopy(true))
+    {
+        LOG_ERROR("TcpConnection::setZeroCopy [%s] SO_ZEROCOPY not supported, errno:%d \n", name().c_str(), errno);
+        return;
+    }
+    outputBuffer_.enableZeroCopy(thresholdBytes, std::move(stats));
+}
+
+void TcpConnection::setReadBackpressure(size_t highBytes, size_t lowBytes)
+{
+    readHighWaterMark_ = highBytes;
+    readLowWaterMark_ = std::min(lowBytes, highBytes);
+}
+
+void TcpConnection::startRead()
+{
+    loop_->runInLoop(std::bind(&TcpConnection::startReadInLoop, shared_from_this()));
+}
+
+void TcpConnection::stopRead()
+{
+    loop_->runInLoop(std::bind(&TcpConnection::stopReadInLoop, shared_from_this()));
+}
+
+void TcpConnection::startReadInLoop()
+{
+    reading_ = true;
+    updateReading();
+}
+
+void TcpConnection::stopReadInLoop()
+{
+    reading_ = false;
+    updateReading();
+}
+
+void TcpConnection::updateReading()
+{
+    if (state_ != kConnected && state_ != kDisconnecting)
+    {
+        return;
+    }
+    bool wantRead = reading_ && !backpressured_;
+    if (wantRead && !channel_.isReading())
+    {
+        channel_.enableReading(); // 边缘触发时重新注册也会报告已经积压的数据
+    }
+    else if (!wantRead && channel_.isReading())
+    {
+        channel_.disableReading();
+    }
 }
 
+void TcpConnection::checkLowWaterMark()
+{
+    if (backpressured_ && outputBuffer_.readableBytes() <= readLowWaterMark_)
+    {
+        backpressured_ = false;
+        updateReading();
+    }
+}
 
 //表示fd有数据可读
 void TcpConnection::handleRead(Timestamp receiveTime)
 {
-    int savedErrno = 0;
-    ssize_t n = inputBuffer_.readFd(channel_->fd(), &savedErrno);
-    if (n > 0) 
+    if (releaseIdleBuffers_)
     {
-        // 已建立连接的用户，有可读事件发生了，调用用户传入的回调操作 onMessage
-        // shared_from_this: 获取当前TcpConnection对象的一个智能指针 TcpConnectionPtr
-        messageCallback_(shared_from_this(), &inputBuffer_, receiveTime);
+        inputBuffer_.acquireFrom(loop_->bufferPool());
     }
-    else if (n == 0)
+
+    if (channel_.edgeTriggered())
     {
-        handleClose();
+        handleReadEdgeTriggered(receiveTime);
     }
     else
     {
-        errno = savedErrno;
-        LOG_ERROR("TcpConnection::handleRead error! ");
-        handleError();
+        int savedErrno = 0;
+        ssize_t n = inputBuffer_.readFd(channel_.fd(), &savedErrno, readExtraBufSize_);
+        if (n > 0) 
+        {
+            idleEntry_.touch(); // 刷新空闲超时，只是记一下当前tick
+
+            // 已建立连接的用户，有可读事件发生了，调用用户传入的回调操作 onMessage
+            // shared_from_this: 获取当前TcpConnection对象的一个智能指针 TcpConnectionPtr
+            messageCallback_(shared_from_this(), &inputBuffer_, receiveTime);
+        }
+        else if (n == 0)
+        {
+            handleClose();
+        }
+        else
+        {
+            errno = savedErrno;
+            LOG_ERROR("TcpConnection::handleRead error! ");
+            handleError();
+        }
+    }
+
+    if (releaseIdleBuffers_)
+    {
+        scheduleBufferRelease();
+    }
+}
+
+// 边缘触发：这次通知之后fd上的数据不会再通知，要读到EAGAIN为止
+// 每次最多读ioBudget_字节（有时间预算时onMessage累计最多执行ioTimeBudget_秒），用完了剩下的推迟到下一轮再读
+void TcpConnection::handleReadEdgeTriggered(Timestamp receiveTime)
+{
+    // 没有时间预算就一次读满字节预算再回调；有时间预算要分批回调，才有机会在两批之间检查时间
+    const size_t batch = ioTimeBudget_ > 0 ? std::min(readExtraBufSize_, ioBudget_) : ioBudget_;
+    const Timestamp start = ioTimeBudget_ > 0 ? Timestamp::now() : receiveTime;
+    size_t total = 0;
+    for (;;)
+    {
+        int savedErrno = 0;
+        bool peerClosed = false;
+        const size_t want = std::min(batch, ioBudget_ - total);
+        ssize_t n = inputBuffer_.readFdAll(channel_.fd(), want, &savedErrno, &peerClosed, readExtraBufSize_);
+        if (n > 0)
+        {
+            total += n;
+            idleEntry_.touch();
+            messageCallback_(shared_from_this(), &inputBuffer_, receiveTime);
+        }
+
+        if (peerClosed)
+        {
+            handleClose();
+            return;
+        }
+        if (savedErrno != 0 && savedErrno != EAGAIN && savedErrno != EWOULDBLOCK) // EAGAIN说明已经读空了
+        {
+            errno = savedErrno;
+            LOG_ERROR("TcpConnection::handleRead error! ");
+            handleError();
+            handleClose(); // 边缘触发不会再报告这个错误，直接关闭
+            return;
+        }
+        if (n <= 0 || static_cast<size_t>(n) < want)
+        {
+            return; // 读空了
+        }
+        // onMessage里可能stopRead了，或者因为背压暂停了读，恢复读的时候重新注册会再报告
+        if (!channel_.isReading() || (state_ != kConnected && state_ != kDisconnecting))
+        {
+            return;
+        }
+        if (total >= ioBudget_
+            || (ioTimeBudget_ > 0 && timeDifference(Timestamp::now(), start) >= ioTimeBudget_))
+        {
+            loop_->deferToNextIteration(std::bind(&TcpConnection::continueRead, shared_from_this()));
+            return;
+        }
+    }
+}
+
+void TcpConnection::continueRead()
+{
+    if ((state_ == kConnected || state_ == kDisconnecting) && channel_.isReading())
+    {
+        handleRead(Timestamp::now());
+    }
+}
+
+void TcpConnection::continueWrite()
+{
+    if (channel_.isWriting())
+    {
+        handleWrite();
     }
 }
 
 //表示fd可写数据
 void TcpConnection::handleWrite()
 {
-    if (channel_->isWriting())
+    if (channel_.isWriting())
     {
         int savedErrno = 0;
-        ssize_t n = outputBuffer_.writeFd(channel_->fd(), &savedErrno);// 发送数据
+        ssize_t n = 0;
+        if (!channel_.edgeTriggered())
+        {
+            n = outputBuffer_.writeFd(channel_.fd(), &savedErrno);// 发送数据
+            if (n > 0)
+            {
+                outputBuffer_.retrieve(n);
+            }
+        }
+        else
+        {
+            // 边缘触发：写到内核发送缓冲区满（EAGAIN）为止，最多写ioBudget_字节
+            // writeFd在内存段和文件段的交界处会停下，所以不能用"没写完"来判断缓冲区满了
+            size_t written = 0;
+            while (outputBuffer_.readableBytes() > 0 && written < ioBudget_)
+            {
+                ssize_t nw = outputBuffer_.writeFd(channel_.fd(), &savedErrno, ioBudget_ - written);
+                if (nw < 0)
+                {
+                    break;
+                }
+                outputBuffer_.retrieve(nw);
+                written += nw;
+            }
+            // 先写出去一部分再出错（比如文件段被截断，EIO）也要当成出错：发送缓冲区没满，不会再有EPOLLOUT通知
+            const bool failed = savedErrno != 0 && savedErrno != EAGAIN && savedErrno != EWOULDBLOCK && savedErrno != EINTR;
+            n = written > 0 && !failed ? written : -1;
+            if (n < 0 && (savedErrno == EAGAIN || savedErrno == EWOULDBLOCK))
+            {
+                return;
+            }
+            if (written >= ioBudget_ && outputBuffer_.readableBytes() > 0)
+            {
+                loop_->deferToNextIteration(std::bind(&TcpConnection::continueWrite, shared_from_this()));
+            }
+        }
+
         if (n > 0)
         {
-            outputBuffer_.retrieve(n);
+            checkLowWaterMark();
             if (outputBuffer_.readableBytes() == 0) // 发送完成
             {
-                channel_->disableWriting();
+                channel_.disableWriting();
                 if (writeCompleteCallback_)
                 {   
                     //唤醒loop_对应的thread线程，执行回调
@@ -109,23 +340,43 @@ void TcpConnection::handleWrite()
                 }
             }
         }
-        else 
+        else if (savedErrno != EAGAIN && savedErrno != EWOULDBLOCK && savedErrno != EINTR)
         {
+            // 对端已经重置，或者要发送的文件被截断了，剩下的数据永远发不出去
+            errno = savedErrno;
             LOG_ERROR("TcpConnection::handleWrite error! ");
+            handleClose();
         }
     } 
     else  //调用handleWrite但是channel此时是不可写状态
     {
-        LOG_ERROR("TcpConnection fd = %d is down, no more writing, 'channel_->isWriting()' is False \n", channel_->fd());
+        LOG_ERROR("TcpConnection fd = %d is down, no more writing, 'channel_.isWriting()' is False \n", channel_.fd());
+    }
+
+    if (releaseIdleBuffers_)
+    {
+        scheduleBufferRelease();
     }
 }
 
 //poller => channel::closeCallback => TcpConnection::handleClose
 void TcpConnection::handleClose()
 {
-    LOG_INFO("fd=%d state=%d \n", channel_->fd(), int(state_));
+    LOG_DEBUG("fd=%d state=%d \n", channel_.fd(), int(state_));
+    if (state_ == kDisconnected) // 写出错时已经关过了，同一轮的EPOLLHUP又会走到这里
+    {
+        return;
+    }
     setState(kDisconnected);
-    channel_->disableAll();
+    channel_.disableAll();
+    if (idleEntry_.linked())
+    {
+        loop_->timingWheel()->remove(&idleEntry_);
+    }
+    if (bufferEntry_.linked())
+    {
+        loop_->timingWheel()->remove(&bufferEntry_);
+    }
 
     TcpConnectionPtr connPtr(shared_from_this());
     connectionCallback_(connPtr); // 执行连接关闭的回调
@@ -135,10 +386,17 @@ void TcpConnection::handleClose()
 
 void TcpConnection::handleError()
 {
+    // MSG_ZEROCOPY的完成通知也是从错误队列来的，同样报EPOLLERR，先把它们读走
+    int notifications = 0;
+    if (outputBuffer_.zeroCopyThreshold() > 0)
+    {
+        notifications = outputBuffer_.reapZeroCopy(channel_.fd());
+    }
+
     int optval;
     socklen_t optlen = sizeof optval;
     int err = 0;
-    if (::getsockopt(channel_->fd(), SOL_SOCKET, SO_ERROR, &optval, &optlen) < 0)
+    if (::getsockopt(channel_.fd(), SOL_SOCKET, SO_ERROR, &optval, &optlen) < 0)
     {
         err = errno;
     }
@@ -146,27 +404,231 @@ void TcpConnection::handleError()
     {
         err = optval;
     }
-    LOG_ERROR("TcpConnection::handleError name:%s - SO_ERROR:%d \n", name_.c_str(), err);
+    if (err == 0 && notifications > 0)
+    {
+        return; // 只是零拷贝的完成通知，不是真的出错了
+    }
+    LOG_ERROR("TcpConnection::handleError name:%s - SO_ERROR:%d \n", name().c_str(), err);
 }
 
 // onmessage处理完业务结束 通过send给客户端返回处理结果数据
-// 对外都提供string类型的 
 void TcpConnection::send(const std::string &buf)
+{
+    send(buf.data(), buf.size());
+}
+
+void TcpConnection::send(const void *message, size_t len)
 {
     if (state_ == kConnected) // 连接成功的状态
     {
         if (loop_->isInLoopThread()) //在当前线程下，直接调用TcpConnection::sendInLoop函数发送数据
         {
-            sendInLoop(buf.c_str(), buf.size());
+            sendInLoop(message, len);
+        }
+        else //如果不是，要把数据拷贝一份跟着任务投递到loop所在线程，调用者的内存在任务执行时可能已经释放了
+        {
+            std::shared_ptr<std::string> copy(std::make_shared<std::string>(static_cast<const char*>(message), len));
+            const char *data = copy->data();
+            sendOwned(data, len, std::move(copy));
+        }
+    }
+}
+
+void TcpConnection::send(std::string &&buf)
+{
+    if (state_ == kConnected)
+    {
+        if (loop_->isInLoopThread() && buf.size() < ChainBuffer::kMinRefBytes)
+        {
+            sendInLoop(buf.data(), buf.size()); // 很短的数据就算没发完也是拷贝，不用再分配一个shared_ptr
+            return;
+        }
+        std::shared_ptr<std::string> owned(std::make_shared<std::string>(std::move(buf)));
+        const char *data = owned->data();
+        size_t len = owned->size();
+        sendOwned(data, len, std::move(owned));
+    }
+}
+
+void TcpConnection::send(Buffer *buf)
+{
+    if (state_ == kConnected)
+    {
+        std::shared_ptr<Buffer> owned(std::make_shared<Buffer>(0));
+        owned->swap(*buf);
+        const char *data = owned->peek();
+        size_t len = owned->readableBytes();
+        sendOwned(data, len, std::move(owned));
+    }
+}
+
+void TcpConnection::send(const SharedPayload &payload, size_t offset, size_t len)
+{
+    if (!payload || offset >= payload->size())
+    {
+        return;
+    }
+    len = std::min(len, payload->size() - offset);
+    sendOwned(payload->data() + offset, len, payload);
+}
+
+void TcpConnection::sendOwned(const char *data, size_t len, std::shared_ptr<const void> owner)
+{
+    if (state_ == kConnected)
+    {
+        if (loop_->isInLoopThread())
+        {
+            sendOwnedInLoop(data, len, owner);
+        }
+        else
+        {
+            // 任务里持有连接和数据的所有权，执行时两者都还活着
+            loop_->runInLoop(std::bind(&TcpConnection::sendOwnedInLoop, shared_from_this(), data, len, std::move(owner)));
         }
-        else //如果不是，通过runInLoop找到loop_所在线程，并通过绑定函数bind将TcpConnection::sendInLoop绑定到loop中
+    }
+}
+
+void TcpConnection::sendOwnedInLoop(const char *data, size_t len, const std::shared_ptr<const void> &owner)
+{
+    struct iovec vec;
+    vec.iov_base = const_cast<char*>(data);
+    vec.iov_len = len;
+    sendvInLoop(&vec, 1, owner);
+}
+
+// 多段数据：chunks整体被移动进来，由一个shared_ptr持有
+void TcpConnection::send(std::vector<std::string> chunks)
+{
+    if (state_ == kConnected)
+    {
+        std::shared_ptr<std::vector<std::string>> owned(
+            std::make_shared<std::vector<std::string>>(std::move(chunks)));
+        if (loop_->isInLoopThread())
+        {
+            sendChunksInLoop(owned);
+        }
+        else
+        {
+            loop_->runInLoop(std::bind(&TcpConnection::sendChunksInLoop, shared_from_this(), owned));
+        }
+    }
+}
+
+void TcpConnection::sendChunksInLoop(const std::shared_ptr<std::vector<std::string>> &chunks)
+{
+    std::vector<struct iovec> iov;
+    iov.reserve(chunks->size());
+    for (std::string &chunk : *chunks)
+    {
+        if (!chunk.empty())
+        {
+            struct iovec vec;
+            vec.iov_base = &chunk[0];
+            vec.iov_len = chunk.size();
+            iov.push_back(vec);
+        }
+    }
+    sendvInLoop(iov.data(), static_cast<int>(iov.size()), chunks);
+}
+
+void TcpConnection::sendInLoop(const void* data, size_t len)
+{
+    struct iovec vec;
+    vec.iov_base = const_cast<void*>(data);
+    vec.iov_len = len;
+    sendvInLoop(&vec, 1, std::shared_ptr<const void>());
+}
+
+//发送缓冲区剩余数据 + 剩余还没发送的数据 >= 水位线  
+//且发送缓冲区剩余数据小于水位线 就原本是小于的加上这一些大于了
+void TcpConnection::checkHighWaterMark(size_t adding)
+{
+    //目前发送缓冲区剩余的待发送数据的长度
+    size_t oldLen = outputBuffer_.readableBytes();
+    if (oldLen + adding >= highWaterMark_
+        && oldLen < highWaterMark_
+        && highWaterMarkCallback_)
+    {
+        loop_->queueInLoop(
+            std::bind(highWaterMarkCallback_, shared_from_this(), oldLen + adding)
+        );
+    }
+    // 自动背压：对端收得比我们产生响应慢，先不读它新的请求了
+    if (readHighWaterMark_ > 0 && !backpressured_ && oldLen + adding >= readHighWaterMark_)
+    {
+        backpressured_ = true;
+        updateReading();
+    }
+}
+
+void TcpConnection::sendFile(int fd, off_t offset, size_t len)
+{
+    if (state_ != kConnected || len == 0)
+    {
+        return;
+    }
+    // dup一份，调用者返回以后就可以关掉自己的fd；这一段发完（或者连接销毁）时关闭
+    int fileFd = ::fcntl(fd, F_DUPFD_CLOEXEC, 0);
+    if (fileFd < 0)
+    {
+        LOG_ERROR("TcpConnection::sendFile dup fd = %d error : %d \n", fd, errno);
+        return;
+    }
+    std::shared_ptr<const void> file(new int(fileFd), [](int *p) { ::close(*p); delete p; });
+    if (loop_->isInLoopThread())
+    {
+        sendFileInLoop(file, fileFd, offset, len);
+    }
+    else
+    {
+        loop_->runInLoop(std::bind(&TcpConnection::sendFileInLoop, shared_from_this(), file, fileFd, offset, len));
+    }
+}
+
+// 和sendvInLoop一样：缓冲区是空的就先直接sendfile一次，剩下的挂到outputBuffer_后面等EPOLLOUT
+void TcpConnection::sendFileInLoop(const std::shared_ptr<const void> &file, int fileFd, off_t offset, size_t len)
+{
+    if (state_ == kDisconnected)
+    {
+        LOG_ERROR("disconnected, give up writing!");
+        return;
+    }
+
+    size_t nwrote = 0;
+    bool faultError = false;
+    const bool corked = cork();
+    if (!corked && !channel_.isWriting() && outputBuffer_.readableBytes() == 0)
+    {
+        off_t off = offset;
+        ssize_t n = ::sendfile(channel_.fd(), fileFd, &off, len);
+        if (n >= 0)
+        {
+            nwrote = n;
+            if (nwrote == len && writeCompleteCallback_)
+            {
+                loop_->queueInLoop(
+                    std::bind(writeCompleteCallback_, shared_from_this())
+                );
+            }
+        }
+        else if (errno != EWOULDBLOCK)
+        {
+            LOG_ERROR("TcpConnection::sendFileInLoop");
+            if (errno == EPIPE || errno == ECONNRESET)
+            {
+                faultError = true;
+            }
+        }
+    }
+
+    size_t remaining = len - nwrote;
+    if (!faultError && remaining > 0)
+    {
+        checkHighWaterMark(remaining);
+        outputBuffer_.appendFile(fileFd, offset + nwrote, remaining, file);
+        if (!corked && !channel_.isWriting())
         {
-            loop_->runInLoop(std::bind(
-                &TcpConnection::sendInLoop,
-                this,
-                buf.c_str(),
-                buf.size()
-            ));
+            channel_.enableWriting();
         }
     }
 }
@@ -174,12 +636,22 @@ void TcpConnection::send(const std::string &buf)
 /**
  * 发送数据  应用 因为是非阻塞IO它写的快， 而内核发送数据慢，需要两者速度匹配
  * 需要把待发送数据写入缓冲区， 而且设置了 水位回调
+ * 多段数据一次writev；没发完的部分：owner为空就拷贝进outputBuffer_，否则直接引用，由owner保证数据有效
  */
-void TcpConnection::sendInLoop(const void* data, size_t len)
+void TcpConnection::sendvInLoop(const struct iovec *iov, int iovcnt, const std::shared_ptr<const void> &owner)
 {
+    size_t len = 0;
+    for (int i = 0; i < iovcnt; ++i)
+    {
+        len += iov[i].iov_len;
+    }
     ssize_t nwrote = 0; //已发送数据
     size_t remaining = len; //还没发送的数据
     bool faultError = false;
+    //足够大的引用数据要零拷贝发送，得先挂进outputBuffer_，由它记住owner直到内核通知完成
+    const size_t zeroCopyThreshold = outputBuffer_.zeroCopyThreshold();
+    const bool zeroCopy = owner && zeroCopyThreshold > 0 && len >= zeroCopyThreshold;
+    bool corked = false;
  
     //之前调用过该connection的shutdown，不能再进行发送了
     if (state_ == kDisconnected)
@@ -187,12 +659,14 @@ void TcpConnection::sendInLoop(const void* data, size_t len)
         LOG_ERROR("disconnected, give up writing!");
         return;
     }
+    corked = cork();
     
     // 表示channel_第一次开始写数据，而且缓冲区没有待发送数据 
     // (Channel向缓冲区写数据，给客户端应用响应)
-    if (!channel_->isWriting() && outputBuffer_.readableBytes() == 0)
+    if (!corked && !zeroCopy && !channel_.isWriting() && outputBuffer_.readableBytes() == 0)
     {
-        nwrote = ::write(channel_->fd(), data, len); //向发送缓冲区中 传入data
+        //向发送缓冲区中 传入data，一次writev最多带ChainBuffer::kMaxIovec段，剩下的进outputBuffer_
+        nwrote = ::writev(channel_.fd(), iov, iovcnt < ChainBuffer::kMaxIovec ? iovcnt : ChainBuffer::kMaxIovec);
         if (nwrote >= 0) //发送成功
         {
             remaining = len - nwrote; //剩余还没有发送完的数据  nwrote是上面的write函数返回的传入data的数量
@@ -223,25 +697,129 @@ void TcpConnection::sendInLoop(const void* data, size_t len)
     //也就是调用TcpConnection::handleWrite方法，把发送缓冲区中的数据全部发送完成
     if (!faultError && remaining > 0)
     {   
-        //目前发送缓冲区剩余的待发送数据的长度
-        size_t oldLen = outputBuffer_.readableBytes();
-        //发送缓冲区剩余数据 + 剩余还没发送的数据 >= 水位线  
-        //且发送缓冲区剩余数据小于水位线 就原本是小于的加上这一些大于了
-        if (oldLen + remaining >= highWaterMark_
-            && oldLen < highWaterMark_
-            && highWaterMarkCallback_)
+        const bool idle = !channel_.isWriting() && outputBuffer_.readableBytes() == 0;
+        checkHighWaterMark(remaining);
+        //把待发送数据发送到outputBuffer缓冲区上，跳过已经写出去的nwrote字节
+        size_t skip = nwrote;
+        for (int i = 0; i < iovcnt; ++i)
+        {
+            const char *base = static_cast<const char*>(iov[i].iov_base);
+            size_t n = iov[i].iov_len;
+            if (skip >= n)
+            {
+                skip -= n;
+                continue;
+            }
+            base += skip;
+            n -= skip;
+            skip = 0;
+            if (owner)
+            {
+                outputBuffer_.appendRef(base, n, owner);
+            }
+            else
+            {
+                outputBuffer_.append(base, n);
+            }
+        }
+        if (corked)
+        {
+            return; // 这一轮结束时由flushCorked发送
+        }
+        if (zeroCopy && idle) // 和上面直接writev一样，不等EPOLLOUT先发一次
+        {
+            int savedErrno = 0;
+            ssize_t n = outputBuffer_.writeFd(channel_.fd(), &savedErrno);
+            if (n > 0)
+            {
+                outputBuffer_.retrieve(n);
+                checkLowWaterMark();
+                if (outputBuffer_.readableBytes() == 0)
+                {
+                    if (writeCompleteCallback_)
+                    {
+                        loop_->queueInLoop(
+                            std::bind(writeCompleteCallback_, shared_from_this())
+                        );
+                    }
+                    return;
+                }
+            }
+            // 出错的话留给handleWrite处理
+        }
+        if (!channel_.isWriting())
+        {
+            channel_.enableWriting(); //这里一定要注册channel的写事件（对读事件感兴趣），否则poller不会给channel通知epollout
+        }
+    }
+}
+
+bool TcpConnection::cork()
+{
+    // 已经在等EPOLLOUT的话，数据本来就只是追加，由handleWrite发送
+    if (!autoCork_ || channel_.isWriting() || !loop_->looping())
+    {
+        return false;
+    }
+    if (!corked_)
+    {
+        corked_ = true;
+        TcpConnectionPtr self(shared_from_this());
+        loop_->addEndOfIterationTask([self]() { self->flushCorked(); });
+    }
+    return true;
+}
+
+// 和handleWrite一样写到outputBuffer_空了或者EAGAIN为止，没写完的注册EPOLLOUT
+// writeFd在内存段、零拷贝段、文件段的交界处会停下，所以要循环
+void TcpConnection::flushCorked()
+{
+    corked_ = false;
+    if (state_ == kDisconnected || channel_.isWriting())
+    {
+        return;
+    }
+
+    int savedErrno = 0;
+    while (outputBuffer_.readableBytes() > 0)
+    {
+        ssize_t n = outputBuffer_.writeFd(channel_.fd(), &savedErrno);
+        if (n < 0)
+        {
+            break;
+        }
+        outputBuffer_.retrieve(n);
+    }
+    checkLowWaterMark();
+
+    if (outputBuffer_.readableBytes() == 0)
+    {
+        if (writeCompleteCallback_)
         {
             loop_->queueInLoop(
-                std::bind(highWaterMarkCallback_, shared_from_this(), oldLen + remaining)
+                std::bind(writeCompleteCallback_, shared_from_this())
             );
         }
-        //把待发送数据发送到outputBuffer缓冲区上
-        outputBuffer_.append((char*)data + nwrote, remaining);
-        if (!channel_->isWriting())
+        if (state_ == kDisconnecting)
         {
-            channel_->enableWriting(); //这里一定要注册channel的写事件（对读事件感兴趣），否则poller不会给channel通知epollout
+            shutdownInLoop();
         }
     }
+    else if (savedErrno == EAGAIN || savedErrno == EWOULDBLOCK || savedErrno == EINTR)
+    {
+        channel_.enableWriting();
+    }
+    else
+    {
+        errno = savedErrno;
+        LOG_ERROR("TcpConnection::flushCorked error! ");
+        handleClose();
+    }
+
+    if (releaseIdleBuffers_)
+    {
+        scheduleBufferRelease();
+    }
 }
 
 // 关闭连接
@@ -251,7 +829,7 @@ void TcpConnection::shutdown()
     {
         setState(kDisconnecting);  // 正在断开连接 不会正真的断开连接需要等待发送缓冲区为空
         loop_->runInLoop(
-            std::bind(&TcpConnection::shutdownInLoop, this)
+            std::bind(&TcpConnection::shutdownInLoop, shared_from_this())
             );
     }
 
@@ -261,10 +839,11 @@ void TcpConnection::shutdown()
 void TcpConnection::shutdownInLoop()
 {   
     //调用了shutdown并不是真正断开连接 只是把状态设置为 kDisconnecting 
-    //等待数据发送完，标志就是 !channel_->isWriting()  channel没在写了 调用shutdownWrite()彻底关闭!
-    if (!channel_->isWriting())//说明outputBuffer中的数据已经全部发送完成
+    //等待数据发送完，标志就是 !channel_.isWriting()  channel没在写了 调用shutdownWrite()彻底关闭!
+    //auto-cork攒着数据的时候也不能关，flushCorked发完以后会再调用这里
+    if (!channel_.isWriting() && !corked_)//说明outputBuffer中的数据已经全部发送完成
     {
-        socket_->shutdownWrite();//关闭写端
+        socket_.shutdownWrite();//关闭写端
     }
 }
 
@@ -272,8 +851,14 @@ void TcpConnection::shutdownInLoop()
 void TcpConnection::connectEstablished()
 {
     setState(kConnected);
-    channel_->tie(shared_from_this());// 把当前TcpConneciton的共享指针传过去赋值给一个弱指针，用来监控对象是否被销毁。别channel还在执行的时候把上层的connection对象remove了
-    channel_->enableReading(); // 向poller注册channel的读事件  epollin事件
+    channel_.tie(shared_from_this());// 把当前TcpConneciton的共享指针传过去赋值给一个弱指针，用来监控对象是否被销毁。别channel还在执行的时候把上层的connection对象remove了
+    channel_.enableReading(); // 向poller注册channel的读事件  epollin事件
+
+    if (idleTimeout_ > 0 && loop_->timingWheel())
+    {
+        loop_->timingWheel()->add(&idleEntry_, idleTimeout_,
+            std::bind(&TcpConnection::handleIdleTimeout, std::weak_ptr<TcpConnection>(shared_from_this())));
+    }
 
     // 新连接建立，执行回调
     connectionCallback_(shared_from_this());
@@ -285,8 +870,79 @@ void TcpConnection::connectDestroyed()
     if (state_ == kConnected)
     {
         setState(kDisconnected);
-        channel_->disableAll(); // 把channel感兴趣的事件，从poller中全部del掉
+        channel_.disableAll(); // 把channel感兴趣的事件，从poller中全部del掉
         connectionCallback_(shared_from_this());
     }
-    channel_->remove();//把channel从poller中删除掉
+    if (idleEntry_.linked())
+    {
+        loop_->timingWheel()->remove(&idleEntry_);
+    }
+    if (bufferEntry_.linked())
+    {
+        loop_->timingWheel()->remove(&bufferEntry_);
+    }
+    channel_.remove();//把channel从poller中删除掉
+}
+
+// 连接空闲以后，已经空了的缓冲区不再占着内存：inputBuffer_还给loop的BufferPool，outputBuffer_放掉段数组
+// onMessage没有取走的半包、还没发完的数据都留着
+void TcpConnection::releaseIdleBuffers()
+{
+    inputBuffer_.releaseTo(loop_->bufferPool());
+    outputBuffer_.shrink();
+}
+
+// bufferEntry_没挂在时间轮上，说明这次事件之前连接已经空闲了releaseIdleSeconds_以上（或者是第一次事件）：
+// 偶尔来一条消息的连接处理完马上放掉，同时挂上条目；之后releaseIdleSeconds_以内再有事件就只touch，
+// 一直有数据的连接不会每次事件都还一次缓冲区、再取一次，等它连续空闲releaseIdleSeconds_以后由时间轮放掉
+void TcpConnection::scheduleBufferRelease()
+{
+    TimingWheel *wheel = loop_->timingWheel();
+    if (wheel != nullptr && bufferEntry_.linked())
+    {
+        bufferEntry_.touch();
+        return;
+    }
+    releaseIdleBuffers();
+    if (wheel != nullptr && (state_ == kConnected || state_ == kDisconnecting)) // 已经关闭的连接不再挂上去
+    {
+        wheel->add(&bufferEntry_, releaseIdleSeconds_,
+            std::bind(&TcpConnection::handleBufferIdle, std::weak_ptr<TcpConnection>(shared_from_this())));
+    }
+}
+
+void TcpConnection::handleBufferIdle(const std::weak_ptr<TcpConnection> &weakConn)
+{
+    TcpConnectionPtr conn(weakConn.lock());
+    if (conn)
+    {
+        conn->releaseIdleBuffers();
+    }
+}
+
+// 空闲超时：第一次走正常的shutdown（等outputBuffer发完再关写端）
+// 再过一个超时周期对端还没关（或者数据一直发不出去），就直接handleClose
+void TcpConnection::handleIdleTimeout(const std::weak_ptr<TcpConnection> &weakConn)
+{
+    TcpConnectionPtr conn(weakConn.lock());
+    if (!conn)
+    {
+        return;
+    }
+
+    TimingWheel *wheel = conn->loop_->timingWheel();
+    if (conn->state_ == kConnected)
+    {
+        LOG_DEBUG("TcpConnection::handleIdleTimeout [%s] idle for %.1f seconds, shutdown \n",
+            conn->name().c_str(), conn->idleTimeout_);
+        conn->shutdown();
+        wheel->add(&conn->idleEntry_, conn->idleTimeout_,
+            std::bind(&TcpConnection::handleIdleTimeout, weakConn));
+    }
+    else if (conn->state_ == kDisconnecting)
+    {
+        LOG_DEBUG("TcpConnection::handleIdleTimeout [%s] peer did not close, force close \n",
+            conn->name().c_str());
+        conn->handleClose();
+    }
 }
\ No newline at end of file
@@ -4,11 +4,17 @@
 #include "InetAddress.h"
 #include "Callbacks.h"
 #include "Buffer.h"
+#include "ChainBuffer.h"
 #include "Timestamp.h"
+#include "TimingWheel.h"
+#include "Socket.h"
+#include "Channel.h"
 
 #include <memory>
 #include <string>
+#include <vector>
 #include <atomic>
+#include <mutex>
 
 
 /*
@@ -16,9 +22,8 @@
     =》 TcpConnection 设置回调 =》 Channel =》 Poller =》 Channel的回调操作
 */
 // 类的前向声明，用于在当前文件中使用这些类，但不需要包含他们的完整定义，用于减少不必要的编译依赖，如果想要具体实现细节（比如调用成员函数），那么需要include头文件，将另一个文件的内容插入到当前文件中
-class Channel;
 class EventLoop;
-class Socket;
+struct iovec;
 
 class TcpConnection : noncopyable, public std::enable_shared_from_this<TcpConnection>
 {
@@ -28,20 +33,49 @@ public:
                 int sockfd,
                 const InetAddress& localAddr_,
                 const InetAddress& peerAddr_);
+    //TcpServer用的构造：名字是 *namePrefix + id，第一次调用name()时才格式化
+    //同一个server的所有连接共享同一个前缀，accept一条连接不用再拼接字符串
+    TcpConnection(EventLoop *loop,
+                uint64_t id,
+                const std::shared_ptr<const std::string> &namePrefix,
+                int sockfd,
+                const InetAddress& localAddr_,
+                const InetAddress& peerAddr_);
     ~TcpConnection();
 
     EventLoop* getLoop() const {return loop_;}
-    const std::string& name() const {return name_;}
+    //所在server内唯一的连接编号，用上面第一个构造函数创建的连接是0
+    uint64_t id() const {return id_;}
+    const std::string& name() const;
     const InetAddress& localAddress() const {return localAddr_;}
     const InetAddress& peerAddress() const {return peerAddr_;}
 
     bool connected() const {return state_ == kConnected;}
 
-    //发送数据
+    //发送数据，都是线程安全的
+    //在其他线程调用时，数据的所有权会跟着投递到loop的任务一起走，调用返回以后参数就可以释放了
     void send(const std::string &buf); // 这个要在public中，因为要被用户调用
-    // void send(const void *message, int len); // 这个没重写
+    void send(const void *message, size_t len);
+    //string被移动进来，没发完的部分直接引用，不拷贝进outputBuffer_
+    void send(std::string &&buf);
+    //把buf的内容交换进来（不拷贝），调用以后buf是空的
+    void send(Buffer *buf);
+    //共享的不可变数据，只发送[offset, offset+len)这一段；多个连接可以同时引用同一份payload
+    void send(const SharedPayload &payload, size_t offset = 0, size_t len = std::string::npos);
+    //多段数据（比如 header + body + trailer）用一次writev发出去，不用先拼接成一个string
+    //chunks被移动进来，没发完的部分直接引用，不再拷贝进outputBuffer_
+    void send(std::vector<std::string> chunks);
+    //发送文件fd从offset开始的len字节，排在已经send的数据后面，由handleWrite用sendfile发送，不经过用户态
+    //内部会dup这个fd，调用返回以后调用者可以关闭自己的fd
+    void sendFile(int fd, off_t offset, size_t len);
     //关闭连接
     void shutdown();
+
+    //暂停/恢复读这个连接（从poller上去掉/加上EPOLLIN），线程安全
+    //比如代理在下游的highWaterMarkCallback里stopRead上游，writeCompleteCallback里再startRead
+    void startRead();
+    void stopRead();
+    bool isReading() const { return reading_; }
     
     void setConnectionCallback(const ConnectionCallback& cb)
     { connectionCallback_ = cb; }
@@ -57,6 +91,43 @@ public:
  
     void setCloseCallback(const CloseCallback& cb)
     { closeCallback_ = cb; }
+
+    // 空闲超时：seconds秒内没有收到数据就shutdown，在connectEstablished之前设置
+    // 需要所在loop已经enableTimingWheel，<= 0 表示不检测
+    void setIdleTimeout(double seconds) { idleTimeout_ = seconds; }
+
+    // 边缘触发模式，在connectEstablished之前设置；budgetBytes是一次读/写事件最多处理的字节数
+    // 预算用完还有数据的，推迟到loop的下一轮接着处理（EventLoop::deferToNextIteration）
+    void setEdgeTriggered(bool on, size_t budgetBytes);
+    // 边缘触发时一次读事件里onMessage累计的执行时间预算，超过了就让出，剩下的数据下一轮再读；<= 0 表示不限制
+    // 设置以后每次最多读readExtraBufSize字节就回调一次onMessage，而不是读满budgetBytes才回调
+    // 水平触发每次事件只读一次，本来就会轮到其他连接，不受影响
+    void setIoTimeBudget(double seconds) { ioTimeBudget_ = seconds; }
+
+    // 一次readv除了inputBuffer_的剩余空间，还能多读多少字节（用的是线程局部的缓冲区）；0按默认值处理
+    void setReadExtraBufSize(size_t bytes) { readExtraBufSize_ = bytes > 0 ? bytes : Buffer::kDefaultExtraBufSize; }
+
+    // 自动背压：outputBuffer_积压到highBytes以上时暂停读这个连接，handleWrite发到lowBytes以下再恢复
+    // 对端只发不收时每个连接的内存就有了上限；和startRead/stopRead互不影响，两边都允许读才会读；highBytes为0表示关闭
+    void setReadBackpressure(size_t highBytes, size_t lowBytes);
+
+    // auto-cork：在loop里send只追加到outputBuffer_，这一轮处理完事件以后统一flush一次
+    // 一次请求里多次send的小数据合成一次系统调用、一个TCP段；在connectEstablished之前设置
+    void setAutoCork(bool on) { autoCork_ = on; }
+
+    // 空闲连接的缓冲区空了就放掉内存：inputBuffer_还给loop的BufferPool，下次有数据时再取，扩容过的缓冲区也借此缩回去
+    // 之前idleSeconds以上没有读写的连接，这次事件处理完马上放掉；idleSeconds以内接连有事件的连接一直占着，
+    // 连续idleSeconds没有读写以后再放（用所在loop的时间轮判断，按tick取整），不会每次事件都还一次再取一次
+    // 适合大量长时间没有数据的连接（推送之类），在connectEstablished之前设置；loop没有开启时间轮时每次事件处理完都马上放掉
+    void setReleaseIdleBuffers(bool on, double idleSeconds = 1.0)
+    {
+        releaseIdleBuffers_ = on;
+        releaseIdleSeconds_ = idleSeconds;
+    }
+
+    // 不小于thresholdBytes的引用数据（send(std::string&&)、send(SharedPayload)、多段send等）用MSG_ZEROCOPY发送
+    // 数据的所有权要等内核通知发送完成才放掉，拷贝进outputBuffer_的数据不受影响；stats可以多个连接共用
+    void setZeroCopy(size_t thresholdBytes, std::shared_ptr<ZeroCopyStats> stats);
  
     //连接建立
     void connectEstablished();
@@ -71,21 +142,57 @@ private:
     void setState(StateE state) { state_ = state; }
  
     void handleRead(Timestamp receiveTime);
+    void handleReadEdgeTriggered(Timestamp receiveTime);
     void handleWrite();
     void handleClose();
     void handleError();
 
+    // 边缘触发时预算用完，fd上还可能有数据/空间，不会再有通知，推迟到loop的下一轮接着处理
+    void continueRead();
+    void continueWrite();
+
     void sendInLoop(const void* message, size_t len);
+    // 从其他线程投递过来的数据，由owner持有；在loop线程里也用它来发送引用的数据
+    void sendOwned(const char *data, size_t len, std::shared_ptr<const void> owner);
+    void sendOwnedInLoop(const char *data, size_t len, const std::shared_ptr<const void> &owner);
+    void sendChunksInLoop(const std::shared_ptr<std::vector<std::string>> &chunks);
+    void sendvInLoop(const struct iovec *iov, int iovcnt, const std::shared_ptr<const void> &owner);
+    void sendFileInLoop(const std::shared_ptr<const void> &file, int fileFd, off_t offset, size_t len);
+    // 开启了auto-cork并且没有在等EPOLLOUT时，在loop这一轮结束时登记一次flushCorked，返回true表示这次只追加不写
+    bool cork();
+    // 把auto-cork攒下的数据写出去，在loop一轮结束时执行
+    void flushCorked();
+    // 要往outputBuffer_里追加adding字节时检查是否越过高水位线
+    void checkHighWaterMark(size_t adding);
     void shutdownInLoop();
+    void startReadInLoop();
+    void stopReadInLoop();
+    // 按reading_和backpressured_决定channel要不要关注读事件
+    void updateReading();
+    // outputBuffer_发出去一部分以后，检查是不是可以解除背压了
+    void checkLowWaterMark();
+
+    void releaseIdleBuffers();
+    // 读写事件处理完以后调用：空闲的连接马上releaseIdleBuffers，忙的连接推迟到空闲releaseIdleSeconds_以后
+    void scheduleBufferRelease();
+    static void handleBufferIdle(const std::weak_ptr<TcpConnection> &weakConn);
+
+    // 时间轮回调，只持有弱引用，连接已经销毁就什么都不做
+    static void handleIdleTimeout(const std::weak_ptr<TcpConnection> &weakConn);
 
     EventLoop *loop_; // 这里绝对不是baseloop，因为Tcpconnection都是在subLoop里管理的
-    const std::string name_;
+    const uint64_t id_;
+    const std::shared_ptr<const std::string> namePrefix_;
+    mutable std::once_flag nameOnce_;
+    mutable std::string name_; // name()第一次被调用时才填上
     std::atomic_int state_;
-    bool reading_;
+    bool reading_; // 用户没有stopRead
+    bool backpressured_; // 发送积压超过了readHighWaterMark_，自动暂停了读
     
     // 这里和Acceptor类似   Acceptor在mainloop里，TcpConnection在subloop里
-    std::unique_ptr<Socket> socket_;
-    std::unique_ptr<Channel> channel_;
+    // 直接作为成员，和连接对象在同一块内存里，不再各自new一次
+    Socket socket_;
+    Channel channel_;
 
     const InetAddress localAddr_;
     const InetAddress peerAddr_;
@@ -97,7 +204,21 @@ private:
     CloseCallback closeCallback_;
 
     size_t highWaterMark_;//水位标志
+    size_t readHighWaterMark_; // 自动背压的上下水位，0表示不开启
+    size_t readLowWaterMark_;
+
+    double idleTimeout_; // 空闲超时的秒数
+    TimingWheel::Entry idleEntry_; // 挂在所在loop时间轮上的条目，收到数据时touch
+
+    size_t ioBudget_; // 边缘触发时一次事件最多读/写的字节数
+    double ioTimeBudget_; // 边缘触发时一次读事件里onMessage最多执行多少秒，<= 0 不限制
+    size_t readExtraBufSize_;
+    bool autoCork_;
+    bool corked_; // 已经登记在loop的flush列表上
+    bool releaseIdleBuffers_;
+    double releaseIdleSeconds_;
+    TimingWheel::Entry bufferEntry_; // 开启releaseIdleBuffers_时挂在时间轮上，有读写就touch，超时说明空闲了
     
     Buffer inputBuffer_;//接收数据的缓冲区
-    Buffer outputBuffer_;//发送数据的缓冲区
+    ChainBuffer outputBuffer_;//发送数据的缓冲区，slab链表，发完的slab还给loop的SlabPool
 };
\ No newline at end of file
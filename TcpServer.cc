@@ -1,9 +1,19 @@
 #include "TcpServer.h"
 #include "Logger.h"
 #include "TcpConnection.h"
+#include "PoolAllocator.h"
 
 #include <strings.h>
+#include <chrono>
 #include <functional>
+#include <future>
+
+namespace
+{
+    // allocate_shared的一块内存 = 控制块（虚表指针、两个计数、分配器）+ TcpConnection，留点余量
+    const size_t kConnectionBlockSize = sizeof(TcpConnection) + 64;
+    const size_t kConnectionPoolMaxFree = 1024; // 每个loop最多缓存多少个空闲的连接对象
+}
 
 static EventLoop* CheckLoopNotNull (EventLoop* loop)  // 防止不同文件函数名字冲突
 {
@@ -21,12 +31,30 @@ TcpServer::TcpServer(EventLoop *loop,
             : loop_(CheckLoopNotNull(loop)) // 主loop不能为空啊
             , ipPort_(listenAddr.toIpPort())
             , name_(nameArg)
+            , listenAddr_(listenAddr)
+            , connNamePrefix_(std::make_shared<const std::string>(nameArg + "-" + ipPort_ + "#"))
             , acceptor_(new Acceptor(loop, listenAddr, option == kReusePort))
             , threadPool_(new EventLoopThreadPool(loop, name_))
             , connectionCallback_()
             , messageCallback_()
             , nextConnId_(1)
             , started_(0) // 不是静态变量（自动初始化为0），所以得自定义初始化
+            , idleTimeout_(0.0)
+            , idleTickSeconds_(1.0)
+            , idleWheelSize_(60)
+            , edgeTriggered_(false)
+            , ioBudget_(256 * 1024)
+            , ioTimeBudget_(0.0)
+            , readExtraBufSize_(Buffer::kDefaultExtraBufSize)
+            , readHighWaterMark_(0)
+            , readLowWaterMark_(0)
+            , autoCork_(false)
+            , releaseIdleBuffers_(false)
+            , releaseIdleSeconds_(1.0)
+            , zeroCopyThreshold_(0)
+            , zeroCopyStats_(std::make_shared<ZeroCopyStats>())
+            , acceptBatch_(Acceptor::kDefaultAcceptBatch)
+            , reusePortAcceptors_(false)
 {   
     //当有新用户连接时，会执行TcpServer::newConnection回调，代码中是对应的是Acceptor::handleRead()
     //两个参数 fd 地址
@@ -36,17 +64,47 @@ TcpServer::TcpServer(EventLoop *loop,
 
 TcpServer::~TcpServer()
 {
-    for (auto &item : connections_)
-    {   
-        //这个局部的shared_ptr智能指针对象，出右括号，可以自动释放new出来的TcpConnection对象资源了
-        TcpConnectionPtr conn(item.second);
-        item.second.reset();
+    // 每个loop的acceptor和连接都要在它自己的线程里销毁
+    // 在loop线程里析构（比如setThreadNum(0)时的mainloop），或者loop没有在运行，没有别的线程会同时用这个shard，直接销毁
+    // loop在运行的话投递过去并等它做完；投递的任务持有shard，不管什么时候执行shard都还在
+    for (const std::shared_ptr<LoopShard> &shard : shards_)
+    {
+        EventLoop *loop = shard->loop;
+        if (loop->isInLoopThread() || !loop->looping())
+        {
+            destroyShard(shard.get());
+            continue;
+        }
+        // 等的过程中loop可能退出，投递的任务就不会再执行了；谁先把claimed置上谁来销毁，不会销毁两次
+        std::shared_ptr<std::atomic_bool> claimed(std::make_shared<std::atomic_bool>(false));
+        std::shared_ptr<std::promise<void>> done(std::make_shared<std::promise<void>>());
+        std::future<void> finished(done->get_future());
+        std::shared_ptr<LoopShard> s(shard);
+        loop->queueInLoop([s, claimed, done] {
+            if (!claimed->exchange(true))
+            {
+                destroyShard(s.get());
+            }
+            done->set_value();
+        });
+        while (loop->looping() && finished.wait_for(std::chrono::milliseconds(10)) != std::future_status::ready)
+        {
+        }
+        if (!claimed->exchange(true))
+        {
+            destroyShard(shard.get());
+        }
+    }
+}
 
-        //销毁连接
-        conn->getLoop()->runInLoop(
-            std::bind(&TcpConnection::connectDestroyed, conn)
-        );
+void TcpServer::destroyShard(LoopShard *shard)
+{
+    shard->acceptor.reset();
+    for (auto &item : shard->connections)
+    {
+        item.second->connectDestroyed();
     }
+    shard->connections.clear();
 }
 
 //设置底层subloop的个数
@@ -55,29 +113,164 @@ void TcpServer::setThreadNum(int numThreads)
     threadPool_->setThreadNum(numThreads);
 }
 
+void TcpServer::setPollerBackend(Poller::Backend backend)
+{
+    threadPool_->setPollerBackend(backend);
+}
+
+void TcpServer::setIdleTimeout(double seconds, double tickSeconds, size_t wheelSize)
+{
+    idleTimeout_ = seconds;
+    idleTickSeconds_ = tickSeconds;
+    idleWheelSize_ = wheelSize;
+}
+
+void TcpServer::setEdgeTriggered(bool on, size_t budgetBytes)
+{
+    edgeTriggered_ = on;
+    ioBudget_ = budgetBytes;
+}
+
+void TcpServer::setReadBackpressure(size_t highBytes, size_t lowBytes)
+{
+    readHighWaterMark_ = highBytes;
+    readLowWaterMark_ = lowBytes;
+}
+
+void TcpServer::setZeroCopy(bool on, size_t thresholdBytes)
+{
+    zeroCopyThreshold_ = on ? thresholdBytes : 0;
+}
+
+uint64_t TcpServer::deferrals() const
+{
+    uint64_t total = 0;
+    for (EventLoop *ioLoop : threadPool_->getAllLoops())
+    {
+        total += ioLoop->deferrals();
+    }
+    return total;
+}
+
+void TcpServer::setAcceptBatch(int batch)
+{
+    acceptBatch_ = batch;
+    if (acceptor_)
+    {
+        acceptor_->setAcceptBatch(batch);
+    }
+    // start以后调用：setReusePortAcceptors模式下每个subloop的acceptor在它自己的线程里创建和使用，投递过去修改
+    for (const std::shared_ptr<LoopShard> &shard : shards_)
+    {
+        std::shared_ptr<LoopShard> s(shard);
+        shard->loop->runInLoop([s, batch] {
+            if (s->acceptor)
+            {
+                s->acceptor->setAcceptBatch(batch);
+            }
+        });
+    }
+}
+
 //开启服务器监听  实际上就是开启mainloop的acceptor的listen 
 void TcpServer::start()
 {
     if (started_++ == 0)  // 防止一个Tcpserver对象被start多次，第一次为0，后面就++了进不来循环了
     {
         threadPool_->start(threadInitCallback_); // 启动底层的loop线程池
+        if (idleTimeout_ > 0 || releaseIdleBuffers_)
+        {
+            // 在每个loop自己的线程里创建时间轮，排在所有新连接的connectEstablished之前
+            for (EventLoop *ioLoop : threadPool_->getAllLoops())
+            {
+                ioLoop->runInLoop(std::bind(&EventLoop::enableTimingWheel, ioLoop, idleTickSeconds_, idleWheelSize_));
+            }
+        }
+
+        std::vector<EventLoop*> ioLoops = threadPool_->getAllLoops();
+        const bool perLoopAcceptors = reusePortAcceptors_ && ioLoops[0] != loop_;
+        shards_.reserve(ioLoops.size());
+        for (size_t i = 0; i < ioLoops.size(); ++i)
+        {
+            std::shared_ptr<LoopShard> shard(std::make_shared<LoopShard>());
+            shard->loop = ioLoops[i];
+            shard->nextConnId = i + 1;
+            shard->connectionPool = std::make_shared<SlabPool>(kConnectionBlockSize, kConnectionPoolMaxFree);
+            shards_.push_back(shard);
+            shardOfLoop_[ioLoops[i]] = shard.get();
+        }
+
+        if (perLoopAcceptors)
+        {
+            // mainloop构造时绑定的socket不listen，直接关掉，新连接只会分给各个subloop的socket
+            acceptor_.reset();
+            for (auto &shard : shards_)
+            {
+                shard->loop->runInLoop(std::bind(&TcpServer::startLoopAcceptor, this, shard.get()));
+            }
+            return;
+        }
         loop_->runInLoop(std::bind(&Acceptor::listen, acceptor_.get()));
     }
 }
 
+// 在shard所在的subloop线程里执行
+void TcpServer::startLoopAcceptor(LoopShard *shard)
+{
+    shard->acceptor.reset(new Acceptor(shard->loop, listenAddr_, true));
+    shard->acceptor->setAcceptBatch(acceptBatch_);
+    shard->acceptor->setNewConnectionCallback(std::bind(&TcpServer::newConnectionInLoop, this, shard,
+        std::placeholders::_1, std::placeholders::_2));
+    shard->acceptor->listen();
+}
+
 // 有一个新的客户端的连接，acceptor会执行这一个回调
 void TcpServer::newConnection(int sockfd, const InetAddress &peerAddr)//有新连接来了
 {   
-    //轮询算法，选择一个subLoop，来管理channel
-    EventLoop *ioLoop = threadPool_->getNextLoop(); 
+    //按setLoadBalance的策略（默认轮询）选择一个subLoop，来管理channel
+    EventLoop *ioLoop = threadPool_->getLoopForConnection(peerAddr); 
+    auto it = shardOfLoop_.find(ioLoop);
+    if (it == shardOfLoop_.end())
+    {
+        LOG_FATAL("%s:%s:%d loop selector returned a loop not in the thread pool! \n", __FILE__, __FUNCTION__, __LINE__);
+    }
+    LoopShard *shard = it->second;
+
+    TcpConnectionPtr conn(createConnection(shard, sockfd, peerAddr, nextConnId_++));
+
+    /*只要有一个新的客户端连接，最终就会生成响应的TCP connection对象，并直接
+    调用TcpConnection::connectEstablished->做的事情就是把这个连接的state从刚开始的connecting变成connected连接建立。
+    然后tie绑定自己一下，然后channel_->enableReading()向poller中注册这个Channel的epollin事件，开始监听
+    EventLoop *ioLoop = threadPool_->getNextLoop()上面这里选择了一个loop
+    监听事件后 connectionCallback_(shared_from_this())可以开始执行回调了，用户调用connected()判断是否连接成功
+    */
+    // 连接表属于subloop，登记和connectEstablished一起在subloop里做
+    ioLoop->runInLoop(std::bind(&TcpServer::establishConnectionInShard, shard, conn));
+}
+
+// setReusePortAcceptors模式：连接就在accept它的subloop里建立，编号按loop交错分配，不用跨线程同步
+void TcpServer::newConnectionInLoop(LoopShard *shard, int sockfd, const InetAddress &peerAddr)
+{
+    const uint64_t connId = shard->nextConnId;
+    shard->nextConnId += shards_.size();
+    establishConnectionInShard(shard, createConnection(shard, sockfd, peerAddr, connId));
+}
 
-    char buf[64] = {0};
-    snprintf(buf, sizeof buf, "-%s#%d", ipPort_.c_str(), nextConnId_);
-    ++nextConnId_;
-    std::string connName = name_ + buf;
+void TcpServer::establishConnectionInShard(LoopShard *shard, const TcpConnectionPtr &conn)
+{
+    shard->connections[conn->id()] = conn;
+    //设置了如何关闭连接的回调   conn->shutDown()
+    //lambda只有一个指针，能放进std::function的内部存储，std::bind会多一次堆分配
+    conn->setCloseCallback([shard](const TcpConnectionPtr &c) {
+        removeConnectionInShard(shard, c);
+    });
+    conn->connectEstablished();
+}
 
-    LOG_INFO("TcpServer::newConnection [%s] - new connection [%s] from %s \n",
-        name_.c_str(), connName.c_str(), peerAddr.toIpPort().c_str());
+TcpConnectionPtr TcpServer::createConnection(LoopShard *shard, int sockfd, const InetAddress &peerAddr, uint64_t connId)
+{
+    LOG_DEBUG("TcpServer::newConnection [%s] - new connection #%llu from %s \n",
+        name_.c_str(), static_cast<unsigned long long>(connId), peerAddr.toIpPort().c_str());
 
     //通过sockfd获取其绑定的本机的ip地址和端口信息
     sockaddr_in local; // IPv4地址
@@ -90,51 +283,48 @@ void TcpServer::newConnection(int sockfd, const InetAddress &peerAddr)//有新
     InetAddress localAddr(local);
  
     //根据连接成功的sockfd，创建TcpConnection连接对象 
-    //TcpConnection用智能指针管理
-    TcpConnectionPtr conn(new TcpConnection(
-                            ioLoop, //所在的事件循环
-                            connName, //名字
+    //TcpConnection用智能指针管理，对象和控制块一起从所在loop的内存池里分配
+    TcpConnectionPtr conn(std::allocate_shared<TcpConnection>(
+                            PoolAllocator<TcpConnection>(shard->connectionPool),
+                            shard->loop, //所在的事件循环
+                            connId, //编号
+                            connNamePrefix_, //名字的前缀，用到名字时才拼上编号
                             sockfd,   // Socket Channel
                             localAddr, // 本地IP和端口号
                             peerAddr    // 客户端IP和端口号
                             ));
-    connections_[name_] = conn;
     //下面的回调都是用户设置给TcpServer=>TcpConnection=>Channel=>Poller=>notify channel调用回调
     conn->setConnectionCallback(connectionCallback_);
     conn->setMessageCallback(messageCallback_);
     conn->setWriteCompleteCallback(writeCompleteCallback_);
-
-    //设置了如何关闭连接的回调   conn->shutDown()
-    conn->setCloseCallback(
-        std::bind(&TcpServer::removeConnection, this, std::placeholders::_1)
-    );
-
-    /*只要有一个新的客户端连接，最终就会生成响应的TCP connection对象，并直接
-    调用TcpConnection::connectEstablished->做的事情就是把这个连接的state从刚开始的connecting变成connected连接建立。
-    然后tie绑定自己一下，然后channel_->enableReading()向poller中注册这个Channel的epollin事件，开始监听
-    EventLoop *ioLoop = threadPool_->getNextLoop()上面这里选择了一个loop
-    监听事件后 connectionCallback_(shared_from_this())可以开始执行回调了，用户调用connected()判断是否连接成功
-    */
-    // 直接调用TcpConnection::connectEstablished
-    ioLoop->runInLoop(std::bind(&TcpConnection::connectEstablished, conn));
+    conn->setIdleTimeout(idleTimeout_);
+    conn->setReadExtraBufSize(readExtraBufSize_);
+    if (edgeTriggered_)
+    {
+        conn->setEdgeTriggered(true, ioBudget_);
+        conn->setIoTimeBudget(ioTimeBudget_);
+    }
+    conn->setAutoCork(autoCork_);
+    conn->setReleaseIdleBuffers(releaseIdleBuffers_, releaseIdleSeconds_);
+    if (readHighWaterMark_ > 0)
+    {
+        conn->setReadBackpressure(readHighWaterMark_, readLowWaterMark_);
+    }
+    if (zeroCopyThreshold_ > 0)
+    {
+        conn->setZeroCopy(zeroCopyThreshold_, zeroCopyStats_);
+    }
+    return conn;
 }
 
 
-void TcpServer::removeConnection(const TcpConnectionPtr &conn)
-{
-    loop_->runInLoop(
-        std::bind(&TcpServer::removeConnectionInLoop, this,conn)
-    );
-}
-
-void TcpServer::removeConnectionInLoop(const TcpConnectionPtr &conn)
+// 已经在连接所在的loop里了，注销和销毁都不用再经过mainloop
+void TcpServer::removeConnectionInShard(LoopShard *shard, const TcpConnectionPtr &conn)
 {
-    LOG_INFO("TcpServer::removeConnectionInLoop [%s] - connection %s\n", 
-        name_.c_str(), conn->name().c_str());
+    LOG_DEBUG("TcpServer::removeConnectionInShard - connection %s\n", conn->name().c_str());
 
-    connections_.erase(conn->name());
-    EventLoop *ioLoop = conn->getLoop(); //拿这条连接对应的loop
-    ioLoop->queueInLoop( //去执行该连接的关闭
+    shard->connections.erase(conn->id());
+    shard->loop->queueInLoop( //去执行该连接的关闭
         std::bind(&TcpConnection::connectDestroyed, conn)
     );
 }
\ No newline at end of file
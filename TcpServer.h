@@ -8,12 +8,14 @@
 #include "Callbacks.h"
 #include "TcpConnection.h"
 #include "Buffer.h"
+#include "SlabPool.h"
 
 #include <functional>
 #include <string>
 #include <memory>
 #include <atomic>
 #include <unordered_map>
+#include <vector>
 
 /**
  * 用户使用muduo编写服务器程序
@@ -48,21 +50,98 @@ public:
 
     //设置底层subloop的个数
     void setThreadNum(int numThreads);
+    //新连接分给哪个subloop，在start之前调用，默认轮询；setReusePortAcceptors模式下由内核分配，不用这个
+    void setLoadBalance(EventLoopThreadPool::Policy policy) { threadPool_->setPolicy(policy); }
+    void setLoopSelector(const EventLoopThreadPool::LoopSelector &selector) { threadPool_->setLoopSelector(selector); }
+    //subloop使用的IO复用（epoll或者io_uring），在start之前调用；mainloop由用户自己构造EventLoop时指定
+    void setPollerBackend(Poller::Backend backend);
+
+    //空闲连接超时：seconds秒没有收到数据的连接会被关闭，在start之前调用
+    //每个loop用一个时间轮检测，tickSeconds是检测精度，wheelSize是轮子的槽数（tickSeconds*wheelSize最好不小于seconds）
+    void setIdleTimeout(double seconds, double tickSeconds = 1.0, size_t wheelSize = 60);
+
+    //连接的fd用边缘触发（EPOLLET）注册，在start之前调用
+    //每次通知会一直读/写到EAGAIN，budgetBytes是一次事件最多读/写的字节数，用完了推迟到loop的下一轮接着处理
+    void setEdgeTriggered(bool on, size_t budgetBytes = 256 * 1024);
+
+    //边缘触发时一次读事件里onMessage累计执行时间的预算，超过了剩下的数据推迟到下一轮，在start之前调用
+    //一个连接的onMessage很重时，同一个loop上的其他连接不用等它把budgetBytes全部处理完
+    void setIoTimeBudget(double seconds) { ioTimeBudget_ = seconds; }
+    //所有subloop累计推迟到下一轮的次数，用来调整上面两个预算，start之后调用
+    uint64_t deferrals() const;
+
+    //每次读socket时，inputBuffer装不下的部分先读到loop线程里一块复用的缓冲区，这里设置它的大小，默认64K
+    //大消息多的服务调大可以减少readv次数，小消息的服务调小可以省内存；0按默认值处理
+    void setReadExtraBufSize(size_t bytes) { readExtraBufSize_ = bytes > 0 ? bytes : Buffer::kDefaultExtraBufSize; }
+
+    //自动背压：连接的发送缓冲区积压到highBytes以上时暂停读它，发到lowBytes以下再恢复，在start之前调用
+    //对端只发请求不收响应时，每个连接的内存有上限；highBytes为0表示关闭（默认）
+    void setReadBackpressure(size_t highBytes, size_t lowBytes);
+
+    //auto-cork：连接在一轮事件里多次send的数据攒起来，这一轮结束时每个连接只写一次，在start之前调用
+    //适合一个请求的响应由多次send拼起来的服务（header、body分开发之类）
+    void setAutoCork(bool on) { autoCork_ = on; }
+
+    //空闲连接的缓冲区空了就放掉内存（inputBuffer还给所在loop的池子），有数据时再取，在start之前调用
+    //大部分连接大部分时间都空闲时（推送），每个连接省下一块1K的inputBuffer和发送缓冲区的段数组
+    //idleSeconds以内接连有读写的连接照常占着缓冲区，连续空闲idleSeconds以后才放，不会每次事件都还一次再取一次
+    //空闲用时间轮判断（tick由setIdleTimeout设置，默认1秒），开启以后即使没有设置空闲超时也会创建时间轮
+    void setReleaseIdleBuffers(bool on, double idleSeconds = 1.0)
+    {
+        releaseIdleBuffers_ = on;
+        releaseIdleSeconds_ = idleSeconds;
+    }
+
+    //不小于thresholdBytes的引用数据（send(std::string&&)、send(SharedPayload)等）用MSG_ZEROCOPY发送，在start之前调用
+    //数据太小时内核pin页、发完成通知的开销比拷贝还大，所以只对大数据生效；回环上内核总是会拷贝
+    void setZeroCopy(bool on, size_t thresholdBytes = 32 * 1024);
+    //内核通知的零拷贝发送次数，和实际还是拷贝了（或者退回到普通发送）的次数，所有连接累计
+    uint64_t zeroCopyHits() const { return zeroCopyStats_->hits; }
+    uint64_t zeroCopyFallbacks() const { return zeroCopyStats_->fallbacks; }
+
+    //listenfd每次可读时最多accept多少个新连接，默认Acceptor::kDefaultAcceptBatch
+    //start之后调用也可以，对mainloop和每个subloop（setReusePortAcceptors）的acceptor都生效
+    void setAcceptBatch(int batch);
+
+    //每个subloop自己创建一个监听同一地址的socket（SO_REUSEPORT）和Acceptor，在start之前调用
+    //内核把新连接分摊到各个subloop，连接从accept到销毁都在同一个线程里，不用再跨线程唤醒；mainloop不再accept
+    //setThreadNum(0)时没有subloop，还是由mainloop的Acceptor接收
+    void setReusePortAcceptors(bool on) { reusePortAcceptors_ = on; }
 
     //开启服务器监听 实际上就是开启mainloop的acceptor的listen 
     void start();
 
 private:
+    using ConnectionMap = std::unordered_map<uint64_t, TcpConnectionPtr>; // 哈希表，按连接编号
+
+    //每个loop一份的连接表（setReusePortAcceptors模式下还有这个loop自己的acceptor），只在那个loop的线程里访问
+    //连接的登记、注销和销毁都在它所在的loop里完成，关闭一条连接不用再绕到mainloop
+    struct LoopShard
+    {
+        EventLoop *loop;
+        uint64_t nextConnId; // setReusePortAcceptors模式下各个loop交错分配编号：index+1, index+1+n, ...
+        std::unique_ptr<Acceptor> acceptor;
+        ConnectionMap connections;
+        std::shared_ptr<SlabPool> connectionPool; // 这个loop上TcpConnection对象（连同shared_ptr控制块）的内存池
+    };
+
     //私有的内部使用的接口 
     void newConnection(int sockfd, const InetAddress &peerAddr);//有新连接来了
-    void removeConnection(const TcpConnectionPtr &conn);//有连接断开了，不要这条连接了
-    void removeConnectionInLoop(const TcpConnectionPtr &conn);
-
-    using ConnectionMap = std::unordered_map<std::string, TcpConnectionPtr>; // 哈希表
+    //按TcpServer的设置创建连接对象，还没有设置关闭回调，也还没有connectEstablished
+    //连接对象从shard的connectionPool里分配
+    TcpConnectionPtr createConnection(LoopShard *shard, int sockfd, const InetAddress &peerAddr, uint64_t connId);
+    void startLoopAcceptor(LoopShard *shard);
+    void newConnectionInLoop(LoopShard *shard, int sockfd, const InetAddress &peerAddr);
+    //下面三个都在shard所在的loop线程里执行，只用到shard，TcpServer析构以后才执行也没关系
+    static void establishConnectionInShard(LoopShard *shard, const TcpConnectionPtr &conn);
+    static void removeConnectionInShard(LoopShard *shard, const TcpConnectionPtr &conn);//有连接断开了，不要这条连接了
+    static void destroyShard(LoopShard *shard); //TcpServer析构时关掉shard的acceptor和所有连接
 
     EventLoop *loop_; // 用户自定义的base loop 一个线程一个loop循环 
     const std::string ipPort_; // 服务器的IP地址端口号 
     const std::string name_; // 服务器的名称 
+    const InetAddress listenAddr_;
+    const std::shared_ptr<const std::string> connNamePrefix_; // "name-ip:port#"，连接名字 = 前缀 + 编号
  
     std::unique_ptr<Acceptor> acceptor_; // 运行在mainLoop，任务就是监听新连接事件
     std::shared_ptr<EventLoopThreadPool> threadPool_; // 线程池 one loop per thread
@@ -75,8 +154,28 @@ private:
     ThreadInitCallback threadInitCallback_;//loop线程初始化的回调
     std::atomic_int started_; // 标志
 
-    int nextConnId_;
-
-    ConnectionMap connections_;//保存所有的连接
+    uint64_t nextConnId_; // 只在mainloop里访问
+
+    double idleTimeout_; // <= 0 表示不检测空闲连接
+    double idleTickSeconds_;
+    size_t idleWheelSize_;
+
+    bool edgeTriggered_;
+    size_t ioBudget_; // 边缘触发时一次事件最多读/写的字节数
+    double ioTimeBudget_;
+    size_t readExtraBufSize_;
+
+    size_t readHighWaterMark_; // 0 表示不开启自动背压
+    size_t readLowWaterMark_;
+    bool autoCork_;
+    bool releaseIdleBuffers_;
+    double releaseIdleSeconds_;
+    size_t zeroCopyThreshold_; // 0 表示不用MSG_ZEROCOPY
+    std::shared_ptr<ZeroCopyStats> zeroCopyStats_;
+
+    int acceptBatch_;
+    bool reusePortAcceptors_;
+    std::vector<std::shared_ptr<LoopShard>> shards_; // start时按getAllLoops的顺序创建，之后不再改变；析构时投递出去的销毁任务也持有一份
+    std::unordered_map<EventLoop*, LoopShard*> shardOfLoop_;
 
 };
\ No newline at end of file
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "noncopyable.h"
+#include "Timestamp.h"
+#include "Channel.h"
+#include "Callbacks.h"
+#include "TimerId.h"
+
+#include <set>
+#include <vector>
+
+class EventLoop;
+class Timer;
+
+/**
+ * 定时器队列，每个EventLoop一个
+ * 所有定时器按到期时间放在红黑树(std::set)里，底层只用一个timerfd，它的超时时间始终设为最早到期的那个定时器
+ * timerfd可读 => timerfdChannel_ 读回调 => 一次取出所有已到期的定时器批量执行
+ * addTimer/cancel 可以跨线程调用，通过runInLoop转到loop所在的线程里操作，内部数据结构不需要加锁
+ */
+class TimerQueue : noncopyable
+{
+public:
+    explicit TimerQueue(EventLoop *loop);
+    ~TimerQueue();
+
+    // 线程安全，interval > 0 表示周期定时器
+    TimerId addTimer(TimerCallback cb, Timestamp when, double interval);
+    // 线程安全
+    void cancel(TimerId timerId);
+
+private:
+    // 按到期时间排序，到期时间相同的用Timer*区分
+    using Entry = std::pair<Timestamp, Timer*>;
+    using TimerList = std::set<Entry>;
+    // 按Timer*排序，cancel时用来查找
+    using ActiveTimer = std::pair<Timer*, int64_t>;
+    using ActiveTimerSet = std::set<ActiveTimer>;
+
+    void addTimerInLoop(Timer *timer);
+    void cancelInLoop(TimerId timerId);
+    // timerfd可读时调用
+    void handleRead();
+    // 取出所有已到期的定时器
+    std::vector<Entry> getExpired(Timestamp now);
+    // 周期定时器重新插回去，一次性定时器释放掉，然后重新设置timerfd
+    void reset(const std::vector<Entry> &expired, Timestamp now);
+    // 返回插入的定时器是否成为最早到期的那一个
+    bool insert(Timer *timer);
+
+    EventLoop *loop_;
+    const int timerfd_;
+    Channel timerfdChannel_;
+
+    TimerList timers_; // timers_ 和 activeTimers_ 保存的是同一批定时器
+    ActiveTimerSet activeTimers_;
+
+    bool callingExpiredTimers_; // 正在执行到期的回调
+    ActiveTimerSet cancelingTimers_; // 回调执行期间被cancel的周期定时器，不能再插回去
+};
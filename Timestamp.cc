@@ -1,29 +1,34 @@
 #include "Timestamp.h"
 #include <time.h>
+#include <sys/time.h>
 
 Timestamp::Timestamp() : microSecondsSinceEpoch_(0) {}
 Timestamp::Timestamp(int64_t microSencondsSinceEpoch) : microSecondsSinceEpoch_(microSencondsSinceEpoch) {}
 
 
-//显示当前时间 
+//显示当前时间  gettimeofday是vdso实现的，不会真正陷入内核
 Timestamp Timestamp::now()
 {
-    time_t timenow = time(NULL);
-    return Timestamp(timenow);
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    int64_t seconds = tv.tv_sec;
+    return Timestamp(seconds * kMicroSecondsPerSecond + tv.tv_usec);
 }
 
 //格式转化方法 将字符串转化成时间字符串
 std::string Timestamp::toString() const
 {
     char buf[128] = {0};
-    tm *tm_time = localtime(&microSecondsSinceEpoch_);
+    time_t seconds = secondsSinceEpoch();
+    tm tm_time;
+    localtime_r(&seconds, &tm_time);
     snprintf(buf, 128, "%4d/%02d/%02d %02d:%02d:%02d",
-        tm_time->tm_year+1900,
-        tm_time->tm_mon+1,
-        tm_time->tm_mday,
-        tm_time->tm_hour,
-        tm_time->tm_min,
-        tm_time->tm_sec);
+        tm_time.tm_year+1900,
+        tm_time.tm_mon+1,
+        tm_time.tm_mday,
+        tm_time.tm_hour,
+        tm_time.tm_min,
+        tm_time.tm_sec);
     return buf;
 }
 
@@ -2,16 +2,50 @@
 
 #include<string>
 #include<iostream>
+#include<stdint.h>
+#include<time.h>
 
 class Timestamp
 {
 public:
     Timestamp(); // 默认构造
     explicit Timestamp(int64_t microSecondsSinceEpoch); // 带参数构造 // explicit用于含有一个参数的构造函数，禁止类对象之间的隐式转换，以及禁止隐式调用拷贝构造函数
-    static Timestamp now(); // now方法 获取当前的时间
+    static Timestamp now(); // now方法 获取当前的时间（微秒精度，定时器需要）
+    static Timestamp invalid() { return Timestamp(); } // 无效时间，内部值为0
     std::string  toString() const;// 获取当前时间年月日格式输出
 
+    bool valid() const { return microSecondsSinceEpoch_ > 0; }
+    int64_t microSecondsSinceEpoch() const { return microSecondsSinceEpoch_; }
+    time_t secondsSinceEpoch() const { return static_cast<time_t>(microSecondsSinceEpoch_ / kMicroSecondsPerSecond); }
+
+    static const int kMicroSecondsPerSecond = 1000 * 1000;
+
 private:
     int64_t microSecondsSinceEpoch_; // 底层成员变量是一个int64_t位的记录事件的整数microSecondsSinceEpoch_
 
-};
\ No newline at end of file
+};
+
+// 定时器按到期时间排序需要比较大小
+inline bool operator<(Timestamp lhs, Timestamp rhs)
+{
+    return lhs.microSecondsSinceEpoch() < rhs.microSecondsSinceEpoch();
+}
+
+inline bool operator==(Timestamp lhs, Timestamp rhs)
+{
+    return lhs.microSecondsSinceEpoch() == rhs.microSecondsSinceEpoch();
+}
+
+// 两个时间相差多少秒
+inline double timeDifference(Timestamp high, Timestamp low)
+{
+    int64_t diff = high.microSecondsSinceEpoch() - low.microSecondsSinceEpoch();
+    return static_cast<double>(diff) / Timestamp::kMicroSecondsPerSecond;
+}
+
+// 在timestamp的基础上加上seconds秒
+inline Timestamp addTime(Timestamp timestamp, double seconds)
+{
+    int64_t delta = static_cast<int64_t>(seconds * Timestamp::kMicroSecondsPerSecond);
+    return Timestamp(timestamp.microSecondsSinceEpoch() + delta);
+}
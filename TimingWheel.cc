@@ -0,0 +1,130 @@
+#include "TimingWheel.h"
+#include "EventLoop.h"
+
+#include <math.h>
+
+TimingWheel::Entry::~Entry()
+{
+    if (wheel_)
+    {
+        wheel_->remove(this);
+    }
+}
+
+TimingWheel::TimingWheel(EventLoop *loop, double tickSeconds, size_t numSlots)
+    : loop_(loop)
+    , tickSeconds_(tickSeconds)
+    , slots_(numSlots > 0 ? numSlots : 1)
+    , currentTick_(0)
+{
+    for (Entry &head : slots_) // 哨兵头结点自己指向自己，表示空链表
+    {
+        head.prev_ = &head;
+        head.next_ = &head;
+    }
+    tickTimer_ = loop_->runEvery(tickSeconds_, std::bind(&TimingWheel::onTick, this));
+}
+
+TimingWheel::~TimingWheel()
+{
+    loop_->cancel(tickTimer_);
+    for (Entry &head : slots_) // 还挂着的条目全部摘下来，它们的析构就不会再访问这个轮子
+    {
+        while (head.next_ != &head)
+        {
+            Entry *entry = head.next_;
+            unlink(entry);
+            entry->wheel_ = nullptr;
+        }
+    }
+}
+
+void TimingWheel::add(Entry *entry, double timeoutSeconds, TimeoutCallback cb)
+{
+    if (entry->linked())
+    {
+        entry->wheel_->remove(entry);
+    }
+    // 向上取整，至少一个tick
+    uint64_t ticks = static_cast<uint64_t>(ceil(timeoutSeconds / tickSeconds_));
+    entry->timeoutTicks_ = ticks > 0 ? ticks : 1;
+    entry->lastActive_ = currentTick_;
+    entry->callback_ = std::move(cb);
+    entry->wheel_ = this;
+    link(entry, currentTick_ + entry->timeoutTicks_);
+}
+
+void TimingWheel::remove(Entry *entry)
+{
+    if (entry->wheel_ == this)
+    {
+        unlink(entry);
+        entry->wheel_ = nullptr;
+    }
+}
+
+void TimingWheel::link(Entry *entry, uint64_t expireTick)
+{
+    Entry &head = slots_[expireTick % slots_.size()];
+    entry->prev_ = head.prev_;
+    entry->next_ = &head;
+    head.prev_->next_ = entry;
+    head.prev_ = entry;
+}
+
+void TimingWheel::unlink(Entry *entry)
+{
+    entry->prev_->next_ = entry->next_;
+    entry->next_->prev_ = entry->prev_;
+    entry->prev_ = nullptr;
+    entry->next_ = nullptr;
+}
+
+// 转一格，只处理当前这一个槽
+void TimingWheel::onTick()
+{
+    ++currentTick_;
+    Entry &head = slots_[currentTick_ % slots_.size()];
+    if (head.next_ == &head)
+    {
+        return;
+    }
+
+    // 先把整个槽摘到临时链表上，重新挂回同一个槽的条目（多转一圈）就不会被本次再遍历到
+    Entry pending;
+    pending.next_ = head.next_;
+    pending.prev_ = head.prev_;
+    pending.next_->prev_ = &pending;
+    pending.prev_->next_ = &pending;
+    head.next_ = &head;
+    head.prev_ = &head;
+
+    std::vector<Entry*> expired;
+    while (pending.next_ != &pending)
+    {
+        Entry *entry = pending.next_;
+        unlink(entry);
+        uint64_t expireTick = entry->lastActive_ + entry->timeoutTicks_;
+        if (expireTick <= currentTick_)
+        {
+            entry->wheel_ = nullptr;
+            expired.push_back(entry);
+        }
+        else // 期间被touch过，或者超时时间超过一圈还没转到
+        {
+            link(entry, expireTick);
+        }
+    }
+
+    // 回调里可能会销毁别的条目，所以先把回调都拿出来再统一执行
+    std::vector<TimeoutCallback> callbacks;
+    callbacks.reserve(expired.size());
+    for (Entry *entry : expired)
+    {
+        callbacks.push_back(std::move(entry->callback_));
+    }
+    for (const TimeoutCallback &cb : callbacks)
+    {
+        cb();
+    }
+}
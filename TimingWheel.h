@@ -0,0 +1,85 @@
+#pragma once
+
+#include "noncopyable.h"
+#include "TimerId.h"
+#include "InlineFunction.h"
+
+#include <functional>
+#include <vector>
+#include <stdint.h>
+#include <stddef.h>
+
+class EventLoop;
+
+/**
+ * 哈希时间轮，每个EventLoop最多一个，专门用来做大量连接的空闲超时
+ * 轮子有numSlots个槽，每tickSeconds秒转一格（由EventLoop::runEvery驱动）
+ * 条目(Entry)由使用者自己持有（比如TcpConnection的成员），挂在槽的侵入式双向链表上，增删不分配内存
+ *
+ * touch() 只记录一下最后活跃的tick，O(1)且不动链表；指针转到条目所在的槽时再检查：
+ * 真的超时了就回调，否则按最后活跃时间重新挂到后面的槽上。超时时间超过一圈的条目会多转几圈
+ * 所有接口只能在loop所在的线程里调用
+ */
+class TimingWheel : noncopyable
+{
+public:
+    // 超时回调一般只带一个weak_ptr（std::bind再加一个函数指针），三个指针的内联存储就够了，每个条目因此小一半
+    static const size_t kCallbackInlineSize = 3 * sizeof(void*);
+    using TimeoutCallback = InlineFunction<void(), kCallbackInlineSize, alignof(void*)>;
+
+    class Entry : noncopyable
+    {
+    public:
+        Entry()
+            : prev_(nullptr)
+            , next_(nullptr)
+            , wheel_(nullptr)
+            , timeoutTicks_(0)
+            , lastActive_(0)
+        {}
+        ~Entry();
+
+        bool linked() const { return wheel_ != nullptr; }
+        // 记录一次活动，推迟超时，O(1)
+        void touch();
+
+    private:
+        friend class TimingWheel;
+
+        Entry *prev_;
+        Entry *next_;
+        TimingWheel *wheel_; // 挂在哪个时间轮上，nullptr表示没挂
+        uint64_t timeoutTicks_;
+        uint64_t lastActive_; // 最后一次活跃时轮子的tick
+        TimeoutCallback callback_;
+    };
+
+    TimingWheel(EventLoop *loop, double tickSeconds, size_t numSlots);
+    ~TimingWheel();
+
+    // 把entry挂到轮子上，timeoutSeconds秒内没有touch就执行cb（执行前entry已经摘下来了）
+    void add(Entry *entry, double timeoutSeconds, TimeoutCallback cb);
+    void remove(Entry *entry);
+
+    double tickSeconds() const { return tickSeconds_; }
+    size_t numSlots() const { return slots_.size(); }
+
+private:
+    void onTick();
+    void link(Entry *entry, uint64_t expireTick);
+    static void unlink(Entry *entry);
+
+    EventLoop *loop_;
+    const double tickSeconds_;
+    std::vector<Entry> slots_; // 每个槽是一个带哨兵头结点的环形双向链表
+    uint64_t currentTick_;
+    TimerId tickTimer_;
+};
+
+inline void TimingWheel::Entry::touch()
+{
+    if (wheel_)
+    {
+        lastActive_ = wheel_->currentTick_;
+    }
+}
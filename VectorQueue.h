@@ -0,0 +1,66 @@
+#pragma once
+
+#include <stddef.h>
+#include <utility>
+#include <vector>
+
+/**
+ * 用vector加一个队头下标实现的先进先出队列，接口是ChainBuffer用到的那部分std::deque
+ * libstdc++的std::deque默认构造就要分配一块map和一个512字节的结点，每个连接的ChainBuffer有两个，
+ * 大多数时候还是空的；这里空队列不占任何堆内存，第一次push_back才分配
+ * pop_front只是把队头往后挪，队列变空时下标归零（保留容量），队头空出来太多时才整体前移一次
+ */
+template <typename T>
+class VectorQueue
+{
+public:
+    using const_iterator = typename std::vector<T>::const_iterator;
+
+    VectorQueue() : head_(0) {}
+
+    bool empty() const { return head_ == items_.size(); }
+    size_t size() const { return items_.size() - head_; }
+
+    T& front() { return items_[head_]; }
+    const T& front() const { return items_[head_]; }
+    T& back() { return items_.back(); }
+    const T& back() const { return items_.back(); }
+    T& operator[](size_t i) { return items_[head_ + i]; }
+    const T& operator[](size_t i) const { return items_[head_ + i]; }
+
+    const_iterator begin() const { return items_.begin() + head_; }
+    const_iterator end() const { return items_.end(); }
+
+    void push_back(T &&item) { items_.push_back(std::move(item)); }
+
+    void pop_front()
+    {
+        items_[head_] = T(); // 马上放掉元素持有的资源（比如shared_ptr）
+        if (++head_ == items_.size())
+        {
+            items_.clear();
+            head_ = 0;
+        }
+        else if (head_ >= kCompactThreshold && head_ * 2 >= items_.size())
+        {
+            items_.erase(items_.begin(), items_.begin() + head_);
+            head_ = 0;
+        }
+    }
+
+    // 空的时候连容量一起还给系统
+    void shrink()
+    {
+        if (empty())
+        {
+            std::vector<T>().swap(items_);
+            head_ = 0;
+        }
+    }
+
+private:
+    static const size_t kCompactThreshold = 32;
+
+    std::vector<T> items_;
+    size_t head_;
+};
@@ -0,0 +1,128 @@
+// 连接建立/断开的速率：kClients个客户端线程不停地 connect -> 等服务端的1字节问候 -> close（SO_LINGER为0，直接RST，不留TIME_WAIT）
+// 等问候是为了让客户端不要跑得比服务端accept快，否则listen队列溢出，SYN重传的1秒超时会盖过其他所有开销
+// 默认服务端只有一个loop，每条连接都要走一遍 accept、Poller::updateChannel(ADD)、removeChannel
+// churn_bench N 用N个subloop，mainloop accept以后轮询分给subloop；churn_bench N reuseport 每个subloop自己accept（setReusePortAcceptors）
+// 统计服务端每秒处理完的连接数（accept + close），以及平均每条连接调用了几次operator new（替换了全局的operator new来计数）
+#include <mymuduo/TcpServer.h>
+#include <mymuduo/Logger.h>
+
+#include <atomic>
+#include <chrono>
+#include <new>
+#include <thread>
+#include <vector>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+static const int kClients = 4;
+static const int kConnsPerClient = 25000;
+
+// 客户端线程里只有系统调用，计到的基本都是服务端（连同库里）的分配
+static std::atomic<long> g_allocations(0);
+
+void* operator new(size_t size)
+{
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    void *p = ::malloc(size == 0 ? 1 : size);
+    if (p == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void operator delete(void *p) noexcept
+{
+    ::free(p);
+}
+
+void operator delete(void *p, size_t) noexcept
+{
+    ::free(p);
+}
+
+static void churn(uint16_t port)
+{
+    sockaddr_in addr;
+    ::memset(&addr, 0, sizeof addr);
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    struct linger lg;
+    lg.l_onoff = 1;
+    lg.l_linger = 0;
+    for (int i = 0; i < kConnsPerClient; )
+    {
+        int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        if (::connect(fd, (sockaddr*)&addr, sizeof addr) < 0)
+        {
+            ::close(fd);
+            ::usleep(1000); // 服务端还没开始listen
+            continue;
+        }
+        char greeting;
+        ::read(fd, &greeting, 1);
+        ::setsockopt(fd, SOL_SOCKET, SO_LINGER, &lg, sizeof lg);
+        ::close(fd);
+        ++i;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    const int threads = argc > 1 ? atoi(argv[1]) : 0;
+    const bool reusePort = argc > 2 && strcmp(argv[2], "reuseport") == 0;
+
+    Logger::setLogLevel(FATAL); // RST会让handleRead打ECONNRESET的错误日志
+
+    const uint16_t port = 20101;
+    EventLoop loop;
+    TcpServer server(&loop, InetAddress(port), "churn");
+    server.setThreadNum(threads);
+    server.setReusePortAcceptors(reusePort);
+
+    const int total = kClients * kConnsPerClient;
+    std::atomic_int closed(0); // 多个subloop同时在关连接
+    server.setConnectionCallback([&](const TcpConnectionPtr &conn) {
+        if (conn->connected())
+        {
+            conn->send("x");
+        }
+        else if (++closed == total)
+        {
+            loop.quit(); // 可能在subloop线程里，quit会唤醒mainloop
+        }
+    });
+    server.setMessageCallback([](const TcpConnectionPtr&, Buffer *buf, Timestamp) {
+        buf->retrieveAll();
+    });
+    server.start();
+
+    std::vector<std::thread> clients;
+    clients.reserve(kClients);
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < kClients; ++i)
+    {
+        clients.emplace_back(churn, port);
+    }
+    const long allocationsBefore = g_allocations.load();
+    loop.loop();
+    const long allocations = g_allocations.load() - allocationsBefore;
+    auto end = std::chrono::steady_clock::now();
+    for (auto &t : clients)
+    {
+        t.join();
+    }
+
+    double seconds = std::chrono::duration<double>(end - start).count();
+    printf("threads=%d %-9s %d connections in %.3f s, %.0f conn/s, %.2f allocations/conn\n",
+        threads, reusePort ? "reuseport" : "single", total, seconds, total / seconds,
+        static_cast<double>(allocations) / total);
+    return 0;
+}
@@ -0,0 +1,200 @@
+// 对比连接fd用LT和ET（TcpServer::setEdgeTriggered）两种方式注册时的吞吐
+//   bulk  : kBulkConns个客户端各自一直发送kBulkBytes字节，服务端丢弃，统计MB/s
+//   small : kSmallConns个客户端做pingpong，每轮一次发kPipeline条kMsgSize字节的小消息，服务端原样回显，统计消息数/s
+// 服务端只有一个loop（setThreadNum(0)），客户端每个连接一个阻塞线程
+// 同时打印onMessage被调用的次数：LT每次通知只readv一次，ET会读到EAGAIN为止
+#include <mymuduo/TcpServer.h>
+#include <mymuduo/Logger.h>
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdio.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+static const int kBulkConns = 4;
+static const size_t kBulkBytes = 64 * 1024 * 1024;
+static const int kSmallConns = 16;
+static const int kRounds = 2000;
+static const int kPipeline = 16;
+static const size_t kMsgSize = 32;
+
+static int connectTo(uint16_t port)
+{
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr;
+    ::memset(&addr, 0, sizeof addr);
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    while (::connect(fd, (sockaddr*)&addr, sizeof addr) < 0)
+    {
+        ::usleep(1000); // 服务端还没开始listen
+    }
+    int one = 1;
+    ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof one);
+    return fd;
+}
+
+static bool writeAll(int fd, const char *data, size_t len)
+{
+    while (len > 0)
+    {
+        ssize_t n = ::write(fd, data, len);
+        if (n <= 0)
+        {
+            return false;
+        }
+        data += n;
+        len -= n;
+    }
+    return true;
+}
+
+static bool readAll(int fd, char *data, size_t len)
+{
+    while (len > 0)
+    {
+        ssize_t n = ::read(fd, data, len);
+        if (n <= 0)
+        {
+            return false;
+        }
+        data += n;
+        len -= n;
+    }
+    return true;
+}
+
+struct Result
+{
+    double seconds;
+    long callbacks;
+};
+
+static Result runBulk(bool edgeTriggered, uint16_t port)
+{
+    EventLoop loop;
+    TcpServer server(&loop, InetAddress(port), "bulk");
+    server.setEdgeTriggered(edgeTriggered);
+
+    size_t received = 0;
+    long callbacks = 0;
+    server.setConnectionCallback([](const TcpConnectionPtr&) {});
+    server.setMessageCallback([&](const TcpConnectionPtr&, Buffer *buf, Timestamp) {
+        received += buf->readableBytes();
+        ++callbacks;
+        buf->retrieveAll();
+        if (received >= kBulkBytes * kBulkConns)
+        {
+            loop.quit();
+        }
+    });
+    server.start();
+
+    std::vector<std::thread> clients;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < kBulkConns; ++i)
+    {
+        clients.emplace_back([port] {
+            int fd = connectTo(port);
+            std::string chunk(64 * 1024, 'x');
+            for (size_t sent = 0; sent < kBulkBytes; sent += chunk.size())
+            {
+                if (!writeAll(fd, chunk.data(), chunk.size()))
+                {
+                    break;
+                }
+            }
+            ::close(fd);
+        });
+    }
+    loop.loop();
+    auto end = std::chrono::steady_clock::now();
+
+    for (auto &conn : clients)
+    {
+        conn.join();
+    }
+    Result result;
+    result.seconds = std::chrono::duration<double>(end - start).count();
+    result.callbacks = callbacks;
+    return result;
+}
+
+static Result runSmall(bool edgeTriggered, uint16_t port)
+{
+    EventLoop loop;
+    TcpServer server(&loop, InetAddress(port), "small");
+    server.setEdgeTriggered(edgeTriggered);
+
+    long callbacks = 0;
+    server.setConnectionCallback([](const TcpConnectionPtr&) {});
+    server.setMessageCallback([&](const TcpConnectionPtr &conn, Buffer *buf, Timestamp) {
+        ++callbacks;
+        conn->send(buf->retrieveAllAsString());
+    });
+    server.start();
+
+    std::atomic_int finished(0);
+    std::vector<std::thread> clients;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < kSmallConns; ++i)
+    {
+        clients.emplace_back([&loop, &finished, port] {
+            int fd = connectTo(port);
+            std::string batch(kMsgSize * kPipeline, 'x');
+            std::string echo(batch.size(), '\0');
+            for (int r = 0; r < kRounds; ++r)
+            {
+                if (!writeAll(fd, batch.data(), batch.size()) || !readAll(fd, &echo[0], echo.size()))
+                {
+                    break;
+                }
+            }
+            ::close(fd);
+            if (++finished == kSmallConns)
+            {
+                loop.quit();
+            }
+        });
+    }
+    loop.loop();
+    auto end = std::chrono::steady_clock::now();
+
+    for (auto &conn : clients)
+    {
+        conn.join();
+    }
+    Result result;
+    result.seconds = std::chrono::duration<double>(end - start).count();
+    result.callbacks = callbacks;
+    return result;
+}
+
+int main()
+{
+    Logger::setLogLevel(ERROR);
+
+    printf("%-6s %-5s %12s %14s\n", "case", "mode", "throughput", "onMessage");
+    uint16_t port = 20001;
+    for (int et = 0; et <= 1; ++et)
+    {
+        Result r = runBulk(et, port++);
+        printf("%-6s %-5s %9.1f MB/s %14ld\n", "bulk", et ? "ET" : "LT",
+            kBulkBytes * kBulkConns / r.seconds / 1024 / 1024, r.callbacks);
+    }
+    for (int et = 0; et <= 1; ++et)
+    {
+        Result r = runSmall(et, port++);
+        printf("%-6s %-5s %8.0f msg/s %14ld\n", "small", et ? "ET" : "LT",
+            kSmallConns * kRounds * kPipeline / r.seconds, r.callbacks);
+    }
+    return 0;
+}
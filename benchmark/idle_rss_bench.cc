@@ -0,0 +1,159 @@
+// 大量空闲长连接的内存占用：一个客户端线程依次建立N条回环连接，每条发一个4字节的订阅请求，收到服务端回的"ok\n"以后就一直空闲
+// 建连之前和全部连接空闲以后各读一次本进程的RSS，差值除以N就是每条连接在用户态占的内存（socket缓冲区在内核里，不算RSS）
+//   idle_rss_bench [N]          默认模式：inputBuffer第一次有数据时分配，之后一直占着
+//   idle_rss_bench [N] release  setReleaseIdleBuffers：缓冲区读空了就还给loop的池子
+// 两种模式分开跑，free掉的内存malloc不一定还给系统，放在一个进程里比较不准
+// 默认N=1000000，每条连接两个fd（客户端和服务端），RLIMIT_NOFILE不够时先尽量调高，还不够就减少N
+// 一个源IP最多用6万多个端口，所以客户端轮流bind到127.0.0.1、127.0.0.2 ...
+#include <mymuduo/TcpServer.h>
+#include <mymuduo/Logger.h>
+
+#include <thread>
+#include <vector>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+static const uint16_t kPort = 20301;
+static const int kFirstClientPort = 1024;
+static const int kPortsPerIp = 65536 - kFirstClientPort;
+
+static long rssBytes()
+{
+    long pages = 0;
+    FILE *fp = ::fopen("/proc/self/statm", "r");
+    if (fp)
+    {
+        if (::fscanf(fp, "%*s %ld", &pages) != 1)
+        {
+            pages = 0;
+        }
+        ::fclose(fp);
+    }
+    return pages * ::sysconf(_SC_PAGESIZE);
+}
+
+// 返回最多能支持多少条连接
+static int raiseFdLimit(int wanted)
+{
+    const rlim_t needed = static_cast<rlim_t>(wanted) * 2 + 64;
+    struct rlimit rl;
+    ::getrlimit(RLIMIT_NOFILE, &rl);
+    if (rl.rlim_cur < needed)
+    {
+        rl.rlim_cur = needed;
+        if (rl.rlim_max < needed)
+        {
+            rl.rlim_max = needed;
+        }
+        if (::setrlimit(RLIMIT_NOFILE, &rl) < 0) // 没有权限调高硬限制，就只调到硬限制
+        {
+            ::getrlimit(RLIMIT_NOFILE, &rl);
+            rl.rlim_cur = rl.rlim_max;
+            ::setrlimit(RLIMIT_NOFILE, &rl);
+        }
+    }
+    ::getrlimit(RLIMIT_NOFILE, &rl);
+    return rl.rlim_cur >= needed ? wanted : static_cast<int>((rl.rlim_cur - 64) / 2);
+}
+
+// 第i条连接用的源地址，bind失败（端口被占用）就换下一个
+static int connectOne(int *next)
+{
+    for (;;)
+    {
+        const int i = (*next)++;
+        sockaddr_in src;
+        ::memset(&src, 0, sizeof src);
+        src.sin_family = AF_INET;
+        src.sin_addr.s_addr = htonl(INADDR_LOOPBACK + i / kPortsPerIp);
+        src.sin_port = htons(static_cast<uint16_t>(kFirstClientPort + i % kPortsPerIp));
+
+        sockaddr_in dst;
+        ::memset(&dst, 0, sizeof dst);
+        dst.sin_family = AF_INET;
+        dst.sin_port = htons(kPort);
+        dst.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+        int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        if (fd < 0)
+        {
+            return -1;
+        }
+        if (::bind(fd, (sockaddr*)&src, sizeof src) == 0 && ::connect(fd, (sockaddr*)&dst, sizeof dst) == 0)
+        {
+            return fd;
+        }
+        ::close(fd);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    const int wanted = argc > 1 ? atoi(argv[1]) : 1000000;
+    const bool release = argc > 2 && strcmp(argv[2], "release") == 0;
+    const int total = raiseFdLimit(wanted);
+    if (total < wanted)
+    {
+        printf("RLIMIT_NOFILE too low for %d connections, using %d\n", wanted, total);
+    }
+
+    Logger::setLogLevel(ERROR);
+
+    EventLoop loop;
+    TcpServer server(&loop, InetAddress(kPort), "idle");
+    server.setReleaseIdleBuffers(release);
+    server.setConnectionCallback([](const TcpConnectionPtr&) {});
+    server.setMessageCallback([](const TcpConnectionPtr &conn, Buffer *buf, Timestamp) {
+        buf->retrieveAll();
+        conn->send("ok\n");
+    });
+    server.start();
+
+    std::vector<int> clients;
+    clients.reserve(total);
+    const long rssBefore = rssBytes();
+    long rssAfter = 0;
+
+    std::thread client([&] {
+        int next = 0;
+        char reply[3];
+        for (int i = 0; i < total; ++i)
+        {
+            int fd = connectOne(&next);
+            if (fd < 0 || ::write(fd, "sub\n", 4) != 4 || ::read(fd, reply, sizeof reply) != sizeof reply)
+            {
+                printf("connection %d failed: %s\n", i, strerror(errno));
+                if (fd >= 0)
+                {
+                    ::close(fd);
+                }
+                break;
+            }
+            clients.push_back(fd);
+        }
+        // 服务端回了"ok\n"以后这一轮事件就处理完了，loop里测量时所有连接都已经空闲
+        loop.runInLoop([&] {
+            rssAfter = rssBytes();
+            loop.quit();
+        });
+    });
+    loop.loop();
+    client.join();
+
+    const int conns = static_cast<int>(clients.size());
+    printf("%-7s %d idle connections: rss %.1f MB -> %.1f MB, %.0f bytes/conn\n",
+        release ? "release" : "keep", conns, rssBefore / 1048576.0, rssAfter / 1048576.0,
+        conns > 0 ? static_cast<double>(rssAfter - rssBefore) / conns : 0.0);
+
+    for (int fd : clients)
+    {
+        ::close(fd);
+    }
+    return 0;
+}
@@ -0,0 +1,102 @@
+// 对比 EventLoop::queueInLoop 的两种回调传输方式：
+//   mutex  : 原来的 std::mutex + std::vector，消费者在锁里swap
+//   mpsc   : MpscQueue，无锁push，消费者一次exchange整批取走
+// 1个消费者线程不停地drain，1~32个生产者线程一共push kTotal个回调
+#include <mymuduo/MpscQueue.h>
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <stdio.h>
+
+using Functor = std::function<void()>;
+
+static const int kTotal = 4 * 1000 * 1000;
+
+class MutexQueue
+{
+public:
+    void push(Functor cb)
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        functors_.emplace_back(std::move(cb));
+    }
+
+    template <typename Func>
+    size_t consumeAll(Func &&func)
+    {
+        std::vector<Functor> functors;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            functors.swap(functors_);
+        }
+        for (Functor &f : functors)
+        {
+            func(f);
+        }
+        return functors.size();
+    }
+
+private:
+    std::mutex mutex_;
+    std::vector<Functor> functors_;
+};
+
+template <typename Queue>
+double run(int producers)
+{
+    Queue queue;
+    std::atomic<long> executed(0);
+    std::atomic_bool go(false);
+    const int perProducer = kTotal / producers;
+    const long total = static_cast<long>(perProducer) * producers;
+
+    std::thread consumer([&] {
+        long done = 0;
+        while (done < total)
+        {
+            done += queue.consumeAll([](Functor &f) { f(); });
+        }
+    });
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < producers; ++i)
+    {
+        threads.emplace_back([&] {
+            while (!go)
+            {
+            }
+            for (int n = 0; n < perProducer; ++n)
+            {
+                queue.push([&executed] { executed.fetch_add(1, std::memory_order_relaxed); });
+            }
+        });
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    go = true;
+    for (std::thread &t : threads)
+    {
+        t.join();
+    }
+    consumer.join();
+    auto end = std::chrono::steady_clock::now();
+
+    double seconds = std::chrono::duration<double>(end - start).count();
+    return total / seconds / 1e6;
+}
+
+int main()
+{
+    printf("%10s %14s %14s\n", "producers", "mutex Mops/s", "mpsc Mops/s");
+    for (int producers = 1; producers <= 32; producers *= 2)
+    {
+        double mutexRate = run<MutexQueue>(producers);
+        double mpscRate = run<MpscQueue<Functor>>(producers);
+        printf("%10d %14.2f %14.2f\n", producers, mutexRate, mpscRate);
+    }
+    return 0;
+}
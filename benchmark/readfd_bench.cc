@@ -0,0 +1,78 @@
+// 小消息读取的吞吐：socketpair一端每次写kMsgSize字节，另一端用readFd读出来再retrieveAll
+//   zeroed : 原来的做法，每次readFd都在栈上 char extrabuf[65536] = {0}
+//   reuse  : Buffer::readFd，线程局部复用的extrabuf，不清零
+// 两种方式的系统调用完全一样，差别就是每次读多出来的64K memset
+#include <mymuduo/Buffer.h>
+
+#include <chrono>
+#include <errno.h>
+#include <stdio.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+static const int kMessages = 1000 * 1000;
+static const size_t kMsgSize = 64;
+
+// 原来Buffer::readFd的写法，只能通过公有接口还原
+static ssize_t zeroedReadFd(Buffer *buf, int fd, int *saveErrno)
+{
+    char extrabuf[65536] = {0};
+
+    struct iovec vec[2];
+    const size_t writable = buf->writableBytes();
+    vec[0].iov_base = buf->beginWrite();
+    vec[0].iov_len = writable;
+    vec[1].iov_base = extrabuf;
+    vec[1].iov_len = sizeof extrabuf;
+
+    const int iovcnt = (writable < sizeof extrabuf) ? 2 : 1;
+    const ssize_t n = ::readv(fd, vec, iovcnt);
+    if (n < 0)
+    {
+        *saveErrno = errno;
+    }
+    else if (static_cast<size_t>(n) <= writable)
+    {
+        buf->hasWritten(n);
+    }
+    else
+    {
+        buf->hasWritten(writable);
+        buf->append(extrabuf, n - writable);
+    }
+    return n;
+}
+
+template <typename ReadFunc>
+static double run(ReadFunc readFunc)
+{
+    int fds[2];
+    ::socketpair(AF_UNIX, SOCK_STREAM, 0, fds);
+    char msg[kMsgSize] = {0};
+    Buffer buf;
+    int savedErrno = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < kMessages; ++i)
+    {
+        ::write(fds[0], msg, sizeof msg);
+        readFunc(&buf, fds[1], &savedErrno);
+        buf.retrieveAll();
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    ::close(fds[0]);
+    ::close(fds[1]);
+    return std::chrono::duration<double>(end - start).count();
+}
+
+int main()
+{
+    double zeroed = run(zeroedReadFd);
+    double reuse = run([](Buffer *buf, int fd, int *saveErrno) { return buf->readFd(fd, saveErrno); });
+
+    printf("%-7s %8.3f s %10.0f msg/s %8.0f ns/msg\n", "zeroed", zeroed, kMessages / zeroed, zeroed * 1e9 / kMessages);
+    printf("%-7s %8.3f s %10.0f msg/s %8.0f ns/msg\n", "reuse", reuse, kMessages / reuse, reuse * 1e9 / kMessages);
+    return 0;
+}
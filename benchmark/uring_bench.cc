@@ -0,0 +1,199 @@
+// 对比epoll和io_uring（poll模式）两种Poller后端处理一次请求的系统调用次数和吞吐
+// kConns个客户端做pingpong，每轮发kMsgSize字节，服务端原样回显；服务端只有一个loop（setThreadNum(0)），跑在主线程
+// 在本程序里定义readv/write/epoll_wait等同名函数，覆盖libmymuduo.so对libc的调用，只统计服务端loop线程里的次数
+#include <mymuduo/TcpServer.h>
+#include <mymuduo/Logger.h>
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include <arpa/inet.h>
+#include <dlfcn.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+static const int kConns = 16;
+static const int kRounds = 5000;
+static const size_t kMsgSize = 64;
+
+// 只在服务端loop线程里计数
+static __thread bool t_counting = false;
+static long g_waits = 0; // epoll_wait / io_uring_enter
+static long g_ctls = 0; // epoll_ctl
+static long g_reads = 0; // read / readv
+static long g_writes = 0; // write / writev
+
+template <typename F>
+static F realFunction(const char *name)
+{
+    return reinterpret_cast<F>(::dlsym(RTLD_NEXT, name));
+}
+
+extern "C" ssize_t readv(int fd, const struct iovec *iov, int iovcnt)
+{
+    static auto real = realFunction<ssize_t (*)(int, const struct iovec*, int)>("readv");
+    if (t_counting) ++g_reads;
+    return real(fd, iov, iovcnt);
+}
+
+extern "C" ssize_t read(int fd, void *buf, size_t count)
+{
+    static auto real = realFunction<ssize_t (*)(int, void*, size_t)>("read");
+    if (t_counting) ++g_reads;
+    return real(fd, buf, count);
+}
+
+extern "C" ssize_t write(int fd, const void *buf, size_t count)
+{
+    static auto real = realFunction<ssize_t (*)(int, const void*, size_t)>("write");
+    if (t_counting) ++g_writes;
+    return real(fd, buf, count);
+}
+
+extern "C" ssize_t writev(int fd, const struct iovec *iov, int iovcnt)
+{
+    static auto real = realFunction<ssize_t (*)(int, const struct iovec*, int)>("writev");
+    if (t_counting) ++g_writes;
+    return real(fd, iov, iovcnt);
+}
+
+extern "C" int epoll_wait(int epfd, struct epoll_event *events, int maxevents, int timeout)
+{
+    static auto real = realFunction<int (*)(int, struct epoll_event*, int, int)>("epoll_wait");
+    if (t_counting) ++g_waits;
+    return real(epfd, events, maxevents, timeout);
+}
+
+extern "C" int epoll_ctl(int epfd, int op, int fd, struct epoll_event *event)
+{
+    static auto real = realFunction<int (*)(int, int, int, struct epoll_event*)>("epoll_ctl");
+    if (t_counting) ++g_ctls;
+    return real(epfd, op, fd, event);
+}
+
+// IoUringPoller直接用syscall(__NR_io_uring_enter, ...)，参数最多6个
+extern "C" long syscall(long number, ...)
+{
+    static auto real = realFunction<long (*)(long, ...)>("syscall");
+    va_list ap;
+    va_start(ap, number);
+    long a[6];
+    for (int i = 0; i < 6; ++i)
+    {
+        a[i] = va_arg(ap, long);
+    }
+    va_end(ap);
+#ifdef __NR_io_uring_enter
+    if (t_counting && number == __NR_io_uring_enter) ++g_waits;
+#endif
+    return real(number, a[0], a[1], a[2], a[3], a[4], a[5]);
+}
+
+static int connectTo(uint16_t port)
+{
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr;
+    ::memset(&addr, 0, sizeof addr);
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    while (::connect(fd, (sockaddr*)&addr, sizeof addr) < 0)
+    {
+        ::usleep(1000); // 服务端还没开始listen
+    }
+    int one = 1;
+    ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof one);
+    return fd;
+}
+
+static bool transfer(int fd, char *data, size_t len, bool sending)
+{
+    while (len > 0)
+    {
+        ssize_t n = sending ? ::send(fd, data, len, 0) : ::recv(fd, data, len, 0);
+        if (n <= 0)
+        {
+            return false;
+        }
+        data += n;
+        len -= n;
+    }
+    return true;
+}
+
+static void run(Poller::Backend backend, const char *name, uint16_t port)
+{
+    EventLoop loop(backend);
+    TcpServer server(&loop, InetAddress(port), name);
+    server.setConnectionCallback([](const TcpConnectionPtr&) {});
+    server.setMessageCallback([](const TcpConnectionPtr &conn, Buffer *buf, Timestamp) {
+        conn->send(buf->retrieveAllAsString());
+    });
+    server.start();
+
+    std::atomic_int connected(0);
+    std::atomic_int finished(0);
+    std::vector<std::thread> clients;
+    for (int i = 0; i < kConns; ++i)
+    {
+        clients.emplace_back([&loop, &connected, &finished, port] {
+            int fd = connectTo(port);
+            ++connected;
+            while (connected.load() < kConns)
+            {
+                ::usleep(1000);
+            }
+            std::string msg(kMsgSize, 'x');
+            std::string echo(kMsgSize, '\0');
+            for (int r = 0; r < kRounds; ++r)
+            {
+                if (!transfer(fd, &msg[0], msg.size(), true) || !transfer(fd, &echo[0], echo.size(), false))
+                {
+                    break;
+                }
+            }
+            ::close(fd);
+            if (++finished == kConns)
+            {
+                loop.quit();
+            }
+        });
+    }
+
+    g_waits = g_ctls = g_reads = g_writes = 0;
+    t_counting = true;
+    auto start = std::chrono::steady_clock::now();
+    loop.loop();
+    auto end = std::chrono::steady_clock::now();
+    t_counting = false;
+
+    for (auto &conn : clients)
+    {
+        conn.join();
+    }
+    const double requests = static_cast<double>(kConns) * kRounds;
+    const double seconds = std::chrono::duration<double>(end - start).count();
+    printf("%-8s %9.0f req/s %8.3f %8.3f %8.3f %8.3f %8.3f\n", name, requests / seconds,
+        g_waits / requests, g_ctls / requests, g_reads / requests, g_writes / requests,
+        (g_waits + g_ctls + g_reads + g_writes) / requests);
+}
+
+int main()
+{
+    Logger::setLogLevel(ERROR);
+
+    printf("%-8s %15s %8s %8s %8s %8s %8s\n", "backend", "throughput", "wait", "ctl", "read", "write", "total");
+    printf("%-8s %15s %8s %8s %8s %8s %8s\n", "", "", "/req", "/req", "/req", "/req", "/req");
+    run(Poller::kEPoll, "epoll", 20101);
+    run(Poller::kIoUring, "io_uring", 20102);
+    return 0;
+}
@@ -0,0 +1,123 @@
+// Buffer第一次写入时才分配内存，没分配时peek()等接口照样能用；swap连初始大小一起交换
+// readFd用线程局部的extrabuf：放不下的部分先读进extrabuf再append，extraBufSize为0时也不会readv 0字节
+// acquireFrom/releaseTo在池子和Buffer之间来回倒，还有数据或者扩容过的不还
+#include "Buffer.h"
+#include "BufferPool.h"
+#include "Check.h"
+
+#include <string>
+#include <unistd.h>
+
+// 往pipe里写data，再用readFd读出来
+static ssize_t readThroughPipe(Buffer *buf, const std::string &data, size_t extraBufSize)
+{
+    int fds[2];
+    CHECK(::pipe(fds) == 0);
+    CHECK(::write(fds[1], data.data(), data.size()) == static_cast<ssize_t>(data.size()));
+    int savedErrno = 0;
+    ssize_t n = buf->readFd(fds[0], &savedErrno, extraBufSize);
+    ::close(fds[0]);
+    ::close(fds[1]);
+    return n;
+}
+
+static void testLazyAllocation()
+{
+    Buffer buf;
+    CHECK(buf.capacity() == 0);
+    CHECK(buf.readableBytes() == 0);
+    CHECK(buf.writableBytes() == 0);
+    CHECK(buf.prependableBytes() == Buffer::kCheapPrepend);
+    CHECK(buf.peek() != nullptr); // 没分配时peek()也是一个有效的指针
+    CHECK(buf.peek() == buf.beginWrite());
+    CHECK(buf.retrieveAllAsString().empty());
+
+    buf.append("hello", 5);
+    CHECK(buf.capacity() >= Buffer::kCheapPrepend + Buffer::kInitialSize);
+    CHECK(buf.readableBytes() == 5);
+    CHECK(std::string(buf.peek(), 5) == "hello");
+
+    // 一次写入超过initialSize时按需要的大小分配
+    Buffer big;
+    std::string data(3000, 'x');
+    big.append(data.data(), data.size());
+    CHECK(big.retrieveAllAsString() == data);
+    CHECK(big.readableBytes() == 0);
+    CHECK(big.capacity() >= data.size()); // retrieveAll不释放内存
+}
+
+static void testSwap()
+{
+    Buffer small(16);
+    Buffer large(4096);
+    small.append("abc", 3);
+    small.swap(large);
+    CHECK(large.readableBytes() == 3);
+    CHECK(small.readableBytes() == 0 && small.capacity() == 0);
+
+    // 初始大小跟着交换：small现在按4096分配
+    small.append("x", 1);
+    CHECK(small.capacity() >= Buffer::kCheapPrepend + 4096);
+    CHECK(std::string(large.peek(), 3) == "abc");
+}
+
+static void testReadFd()
+{
+    // 还没分配的Buffer，数据全部先进extrabuf再append
+    Buffer buf;
+    std::string data(5000, 'a');
+    data[4999] = 'z';
+    CHECK(readThroughPipe(&buf, data, Buffer::kDefaultExtraBufSize) == static_cast<ssize_t>(data.size()));
+    CHECK(buf.retrieveAllAsString() == data);
+
+    // 已经分配、放得下的数据直接读进Buffer
+    CHECK(readThroughPipe(&buf, "ping", Buffer::kDefaultExtraBufSize) == 4);
+    CHECK(buf.retrieveAllAsString() == "ping");
+
+    // 没分配、extraBufSize又是0：不能readv 0字节（会被当成对端关闭）
+    Buffer empty;
+    CHECK(readThroughPipe(&empty, "pong", 0) > 0);
+}
+
+static void testPool()
+{
+    BufferPool pool(Buffer::kCheapPrepend + Buffer::kInitialSize, 2);
+    Buffer buf;
+    buf.acquireFrom(&pool);
+    CHECK(buf.capacity() == pool.bufferSize());
+    CHECK(buf.writableBytes() == Buffer::kInitialSize);
+
+    buf.append("data", 4);
+    buf.releaseTo(&pool); // 还有没读的数据，不还
+    CHECK(buf.capacity() == pool.bufferSize());
+    CHECK(pool.freeCount() == 0);
+
+    buf.retrieveAll();
+    buf.releaseTo(&pool);
+    CHECK(buf.capacity() == 0);
+    CHECK(buf.readableBytes() == 0);
+    CHECK(pool.freeCount() == 1);
+
+    // 再取的时候复用池子里那一块
+    buf.acquireFrom(&pool);
+    CHECK(pool.freeCount() == 0);
+    buf.append("again", 5);
+    CHECK(buf.retrieveAllAsString() == "again");
+
+    // 扩容过的大块还回来时直接释放
+    std::string data(4096, 'b');
+    buf.append(data.data(), data.size());
+    buf.retrieveAll();
+    buf.releaseTo(&pool);
+    CHECK(buf.capacity() == 0);
+    CHECK(pool.freeCount() == 0);
+}
+
+int main()
+{
+    testLazyAllocation();
+    testSwap();
+    testReadFd();
+    testPool();
+    return 0;
+}
@@ -0,0 +1,217 @@
+// ChainBuffer：跨slab追加和跨slab的部分retrieve，toIovec的块数/字节数限制，appendRef的owner什么时候放掉，发空以后shrink放掉段数组
+#include "ChainBuffer.h"
+#include "SlabPool.h"
+#include "Check.h"
+
+#include <memory>
+#include <new>
+#include <string>
+#include <stdlib.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+// 统计还没释放的operator new次数，用来确认shrink真的放掉了内存
+static long g_liveAllocations = 0;
+
+void* operator new(size_t size)
+{
+    void *p = ::malloc(size == 0 ? 1 : size);
+    if (p == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+    ++g_liveAllocations;
+    return p;
+}
+
+void operator delete(void *p) noexcept
+{
+    if (p)
+    {
+        --g_liveAllocations;
+        ::free(p);
+    }
+}
+
+static const size_t kSlabSize = 64;
+
+static std::string pattern(size_t len)
+{
+    std::string s(len, '\0');
+    for (size_t i = 0; i < len; ++i)
+    {
+        s[i] = static_cast<char>('a' + i % 26);
+    }
+    return s;
+}
+
+static void testAppendAcrossSlabs()
+{
+    std::shared_ptr<SlabPool> pool = std::make_shared<SlabPool>(kSlabSize);
+    ChainBuffer buf(pool);
+    CHECK(buf.readableBytes() == 0 && buf.numSegments() == 0 && buf.peek() == nullptr);
+
+    const std::string data = pattern(200);
+    buf.append(data.data(), 10);
+    buf.append(data.data() + 10, data.size() - 10); // 接着填满第一个slab，再往后挂
+    CHECK(buf.readableBytes() == 200);
+    CHECK(buf.numSegments() == 4); // 64 + 64 + 64 + 8
+    CHECK(buf.peekableBytes() == kSlabSize);
+    CHECK(std::string(buf.peek(), buf.peekableBytes()) == data.substr(0, kSlabSize));
+    CHECK(buf.retrieveAllAsString() == data);
+    CHECK(buf.numSegments() == 0);
+    CHECK(pool->freeCount() == 4); // 读完的slab都还给了池子
+}
+
+static void testPartialRetrieve()
+{
+    std::shared_ptr<SlabPool> pool = std::make_shared<SlabPool>(kSlabSize);
+    ChainBuffer buf(pool);
+    const std::string data = pattern(200);
+    buf.append(data.data(), data.size());
+
+    // 跨过第一个slab，停在第二个slab中间
+    buf.retrieve(100);
+    CHECK(buf.readableBytes() == 100);
+    CHECK(buf.numSegments() == 3);
+    CHECK(pool->freeCount() == 1);
+    CHECK(buf.peekableBytes() == 2 * kSlabSize - 100);
+    CHECK(std::string(buf.peek(), buf.peekableBytes()) == data.substr(100, 2 * kSlabSize - 100));
+
+    // 正好停在slab边界上
+    buf.retrieve(2 * kSlabSize - 100);
+    CHECK(buf.numSegments() == 2);
+    CHECK(buf.peekableBytes() == kSlabSize);
+
+    CHECK(buf.retrieveAsString(70) == data.substr(2 * kSlabSize, 70));
+    CHECK(buf.readableBytes() == 200 - 2 * kSlabSize - 70);
+
+    // 超过可读长度按可读长度算
+    buf.retrieve(1000);
+    CHECK(buf.readableBytes() == 0 && buf.numSegments() == 0);
+    CHECK(pool->freeCount() == 4);
+}
+
+static void testToIovec()
+{
+    std::shared_ptr<SlabPool> pool = std::make_shared<SlabPool>(kSlabSize);
+    ChainBuffer buf(pool);
+    const std::string data = pattern(200);
+    buf.append(data.data(), data.size());
+    buf.retrieve(10);
+
+    struct iovec iov[8];
+    // 不限制：每个slab一块，第一块从readIndex开始
+    int n = buf.toIovec(iov, 8);
+    CHECK(n == 4);
+    size_t total = 0;
+    std::string joined;
+    for (int i = 0; i < n; ++i)
+    {
+        total += iov[i].iov_len;
+        joined.append(static_cast<const char*>(iov[i].iov_base), iov[i].iov_len);
+    }
+    CHECK(total == buf.readableBytes());
+    CHECK(joined == data.substr(10));
+
+    // 限制块数
+    CHECK(buf.toIovec(iov, 2) == 2);
+    CHECK(iov[0].iov_len == kSlabSize - 10 && iov[1].iov_len == kSlabSize);
+
+    // 限制字节数：最后一块被截短
+    n = buf.toIovec(iov, 8, 100);
+    CHECK(n == 2);
+    CHECK(iov[0].iov_len + iov[1].iov_len == 100);
+    CHECK(iov[1].iov_len == 100 - (kSlabSize - 10));
+
+    // 遇到文件段就停：文件要用sendfile单独发
+    buf.appendFile(STDIN_FILENO, 0, 100, std::shared_ptr<const void>());
+    std::string tail = pattern(600);
+    buf.appendRef(tail.data(), tail.size(), std::make_shared<int>(0));
+    CHECK(buf.toIovec(iov, 8) == 4);
+    buf.retrieve(190);
+    CHECK(buf.peek() == nullptr && buf.peekableBytes() == 0);
+    CHECK(buf.toIovec(iov, 8) == 0);
+    buf.retrieve(100);
+    CHECK(buf.toIovec(iov, 8) == 1 && iov[0].iov_base == tail.data());
+}
+
+static void testAppendRefLifetime()
+{
+    std::shared_ptr<SlabPool> pool = std::make_shared<SlabPool>(kSlabSize);
+    ChainBuffer buf(pool);
+
+    // 调用者放掉自己的引用以后数据还在，retrieve完最后一个字节才释放
+    std::shared_ptr<std::string> payload = std::make_shared<std::string>(pattern(1000));
+    std::weak_ptr<std::string> watcher(payload);
+    const char *data = payload->data();
+    buf.append("head", 4);
+    buf.appendRef(data, payload->size(), payload);
+    payload.reset();
+    CHECK(!watcher.expired());
+    CHECK(buf.numSegments() == 2);
+    CHECK(buf.readableBytes() == 1004);
+
+    struct iovec iov[4];
+    CHECK(buf.toIovec(iov, 4) == 2);
+    CHECK(iov[1].iov_base == data); // 引用，没有拷贝
+
+    buf.retrieve(500);
+    CHECK(!watcher.expired());
+    CHECK(buf.peek() == data + 496);
+    buf.retrieve(504);
+    CHECK(watcher.expired());
+
+    // 短数据直接拷贝进slab，不持有owner
+    std::shared_ptr<std::string> small = std::make_shared<std::string>("tiny");
+    std::weak_ptr<std::string> smallWatcher(small);
+    buf.appendRef(small->data(), small->size(), small);
+    small.reset();
+    CHECK(smallWatcher.expired());
+    CHECK(buf.retrieveAllAsString() == "tiny");
+
+    // 析构时还没发的引用也放掉
+    std::shared_ptr<std::string> pending = std::make_shared<std::string>(pattern(ChainBuffer::kMinRefBytes));
+    std::weak_ptr<std::string> pendingWatcher(pending);
+    {
+        ChainBuffer other(pool);
+        other.appendRef(pending->data(), pending->size(), pending);
+        pending.reset();
+        CHECK(!pendingWatcher.expired());
+    }
+    CHECK(pendingWatcher.expired());
+}
+
+static void testShrinkAfterDrain()
+{
+    std::shared_ptr<SlabPool> pool = std::make_shared<SlabPool>(kSlabSize);
+    ChainBuffer buf(pool);
+    const std::string data = pattern(1000);
+    buf.append(data.data(), data.size());
+
+    // 还有数据时shrink什么都不做
+    buf.shrink();
+    CHECK(buf.readableBytes() == 1000);
+    CHECK(buf.retrieveAsString(1000) == data);
+
+    // 发空以后段数组的容量还留着，shrink才放掉；slab早已还给池子
+    const long before = g_liveAllocations;
+    buf.shrink();
+    CHECK(g_liveAllocations == before - 1);
+    CHECK(pool->freeCount() == (1000 + kSlabSize - 1) / kSlabSize);
+
+    // shrink以后照常使用，slab从池子里复用
+    buf.append(data.data(), 100);
+    CHECK(pool->freeCount() == (1000 + kSlabSize - 1) / kSlabSize - 2);
+    CHECK(buf.retrieveAllAsString() == data.substr(0, 100));
+}
+
+int main()
+{
+    testAppendAcrossSlabs();
+    testPartialRetrieve();
+    testToIovec();
+    testAppendRefLifetime();
+    testShrinkAfterDrain();
+    return 0;
+}
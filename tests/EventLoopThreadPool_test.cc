@@ -0,0 +1,172 @@
+// 新连接选loop的几种策略：看分配结果的分布是否符合预期
+#include "EventLoopThreadPool.h"
+#include "EventLoop.h"
+#include "InetAddress.h"
+#include "Check.h"
+
+#include <future>
+#include <map>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+static const int kNumLoops = 4;
+static const int kPicks = 4000;
+
+// 每个loop被选中的次数
+static std::map<EventLoop*, int> pick(EventLoopThreadPool &pool, int picks)
+{
+    std::map<EventLoop*, int> counts;
+    for (int i = 0; i < picks; ++i)
+    {
+        InetAddress peer(static_cast<uint16_t>(10000 + i), "10.0.0.1");
+        ++counts[pool.getLoopForConnection(peer)];
+    }
+    return counts;
+}
+
+static void testRoundRobin(EventLoop *baseLoop)
+{
+    EventLoopThreadPool pool(baseLoop, "rr");
+    pool.setThreadNum(kNumLoops);
+    pool.start();
+
+    std::map<EventLoop*, int> counts = pick(pool, kPicks);
+    CHECK(counts.size() == static_cast<size_t>(kNumLoops));
+    for (EventLoop *loop : pool.getAllLoops())
+    {
+        CHECK(counts[loop] == kPicks / kNumLoops);
+    }
+}
+
+static void testLeastConnections(EventLoop *baseLoop)
+{
+    EventLoopThreadPool pool(baseLoop, "least");
+    pool.setThreadNum(kNumLoops);
+    pool.setPolicy(EventLoopThreadPool::kLeastConnections);
+    pool.start();
+
+    std::vector<EventLoop*> loops = pool.getAllLoops();
+    for (int i = 0; i < kNumLoops; ++i)
+    {
+        loops[i]->addConnections(i == 2 ? 0 : 4);
+    }
+    CHECK(pool.getLoopForConnection(InetAddress()) == loops[2]);
+
+    // 每次选中以后给那个loop加一个连接，最后应该完全均匀
+    for (int i = 0; i < kPicks; ++i)
+    {
+        pool.getLoopForConnection(InetAddress())->addConnections(1);
+    }
+    for (EventLoop *loop : loops)
+    {
+        CHECK(loop->numConnections() == (kPicks + 12) / kNumLoops);
+    }
+}
+
+static void testPowerOfTwoChoices(EventLoop *baseLoop)
+{
+    EventLoopThreadPool pool(baseLoop, "p2c");
+    pool.setThreadNum(kNumLoops);
+    pool.setPolicy(EventLoopThreadPool::kPowerOfTwoChoices);
+    pool.start();
+    std::vector<EventLoop*> loops = pool.getAllLoops();
+
+    // 负载相同时退化成随机选择，每个loop大约1/4
+    std::map<EventLoop*, int> counts = pick(pool, kPicks);
+    for (EventLoop *loop : loops)
+    {
+        CHECK(counts[loop] > kPicks * 15 / 100 && counts[loop] < kPicks * 35 / 100);
+    }
+
+    // 两次抽到的一定是不同的loop，所以负载最重的那个永远不会被选中；
+    // 负载最轻的那个只要被抽到就会被选中，概率是 1 - C(3,2)/C(4,2) = 1/2
+    for (int i = 0; i < kNumLoops; ++i)
+    {
+        loops[i]->addConnections(i * 10);
+    }
+    counts = pick(pool, kPicks);
+    CHECK(counts[loops[kNumLoops - 1]] == 0);
+    CHECK(counts[loops[0]] > kPicks * 40 / 100 && counts[loops[0]] < kPicks * 60 / 100);
+}
+
+// 连接数一样时，积压着回调的loop不会被选中
+static void testQueuedWork(EventLoop *baseLoop, EventLoopThreadPool::Policy policy)
+{
+    EventLoopThreadPool pool(baseLoop, "queued");
+    pool.setThreadNum(kNumLoops);
+    pool.setPolicy(policy);
+    pool.start();
+    std::vector<EventLoop*> loops = pool.getAllLoops();
+
+    // 第一个回调把loops[0]卡住，后面投递的都排着
+    const int kQueued = 8;
+    std::promise<void> release;
+    std::shared_future<void> released(release.get_future());
+    loops[0]->queueInLoop([released] { released.wait(); });
+    for (int i = 1; i < kQueued; ++i)
+    {
+        loops[0]->queueInLoop([] {});
+    }
+    CHECK(loops[0]->queuedWork() == kQueued);
+    CHECK(loops[0]->numConnections() == loops[1]->numConnections());
+
+    std::map<EventLoop*, int> counts = pick(pool, kPicks);
+    CHECK(counts[loops[0]] == 0);
+
+    release.set_value();
+    while (loops[0]->queuedWork() != 0)
+    {
+        ::usleep(1000);
+    }
+}
+
+static void testConsistentHash(EventLoop *baseLoop)
+{
+    EventLoopThreadPool pool(baseLoop, "hash");
+    pool.setThreadNum(kNumLoops);
+    pool.setPolicy(EventLoopThreadPool::kConsistentHash);
+    pool.start();
+
+    // 同一个IP的不同端口落在同一个loop上
+    std::map<EventLoop*, int> counts = pick(pool, 100);
+    CHECK(counts.size() == 1);
+
+    // 不同的IP大致均匀地分到所有loop上
+    const int kIps = 1024;
+    counts.clear();
+    for (int i = 0; i < kIps; ++i)
+    {
+        std::string ip = "10.0." + std::to_string(i / 256) + "." + std::to_string(i % 256);
+        ++counts[pool.getLoopForConnection(InetAddress(8000, ip))];
+    }
+    CHECK(counts.size() == static_cast<size_t>(kNumLoops));
+    for (const auto &item : counts)
+    {
+        CHECK(item.second > kIps / kNumLoops / 2);
+    }
+}
+
+// 没有subloop时所有连接都给baseLoop，线程初始化回调也在baseLoop上执行
+static void testNoThreads(EventLoop *baseLoop)
+{
+    EventLoopThreadPool pool(baseLoop, "single");
+    EventLoop *initLoop = nullptr;
+    pool.start([&initLoop](EventLoop *loop) { initLoop = loop; });
+    CHECK(initLoop == baseLoop);
+    CHECK(pool.getLoopForConnection(InetAddress()) == baseLoop);
+    CHECK(pool.getNextLoop() == baseLoop);
+}
+
+int main()
+{
+    EventLoop baseLoop;
+    testRoundRobin(&baseLoop);
+    testLeastConnections(&baseLoop);
+    testPowerOfTwoChoices(&baseLoop);
+    testQueuedWork(&baseLoop, EventLoopThreadPool::kLeastConnections);
+    testQueuedWork(&baseLoop, EventLoopThreadPool::kPowerOfTwoChoices);
+    testConsistentHash(&baseLoop);
+    testNoThreads(&baseLoop);
+    return 0;
+}
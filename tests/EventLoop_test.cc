@@ -0,0 +1,42 @@
+// EventLoop::addEndOfIterationTask：任务在这一轮结束前执行，任务执行时又登记的任务也不会拖到下一次poll（最多阻塞10秒）
+#include "EventLoop.h"
+#include "Timestamp.h"
+#include "Check.h"
+
+#include <thread>
+
+static double elapsed(Timestamp start)
+{
+    return static_cast<double>(Timestamp::now().microSecondsSinceEpoch() - start.microSecondsSinceEpoch()) / 1000000.0;
+}
+
+int main()
+{
+    EventLoop loop;
+    int first = 0, nested = 0, deep = 0;
+
+    // 其他线程投递的回调里登记：由doPendingFunctors末尾那一次执行
+    std::thread poster([&] {
+        loop.queueInLoop([&] {
+            loop.addEndOfIterationTask([&] {
+                ++first;
+                loop.addEndOfIterationTask([&] {
+                    ++nested;
+                    loop.addEndOfIterationTask([&] {
+                        ++deep;
+                        loop.quit();
+                    });
+                });
+            });
+        });
+    });
+
+    const Timestamp start(Timestamp::now());
+    loop.runAfter(15, [] { CHECK(!"timed out"); });
+    loop.loop();
+    poster.join();
+
+    CHECK(first == 1 && nested == 1 && deep == 1);
+    CHECK(elapsed(start) < 1.0); // 拖到下一轮的话要等poll超时
+    return 0;
+}
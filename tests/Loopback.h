@@ -0,0 +1,84 @@
+#pragma once
+
+// 回环连接测试用的客户端工具：阻塞socket连本机的TcpServer，按字节数读/读到对端关闭
+#include "Check.h"
+
+#include <string>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// 连接127.0.0.1:port，服务端还没listen时重试；rcvBuf > 0 时先把接收缓冲区调小，服务端一次写不完
+static inline int connectLoopback(uint16_t port, int rcvBuf = 0)
+{
+    for (int retry = 0; retry < 1000; ++retry)
+    {
+        int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        CHECK(fd >= 0);
+        if (rcvBuf > 0)
+        {
+            ::setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcvBuf, sizeof rcvBuf);
+        }
+        sockaddr_in addr;
+        ::memset(&addr, 0, sizeof addr);
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(port);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof addr) == 0)
+        {
+            return fd;
+        }
+        ::close(fd);
+        ::usleep(1000);
+    }
+    CHECK(!"connect to loopback server");
+    return -1;
+}
+
+// 读满len字节，对端提前关闭时返回已经读到的部分
+static inline std::string readBytes(int fd, size_t len)
+{
+    std::string data(len, '\0');
+    size_t got = 0;
+    while (got < len)
+    {
+        ssize_t n = ::read(fd, &data[got], len - got);
+        if (n <= 0)
+        {
+            break;
+        }
+        got += n;
+    }
+    data.resize(got);
+    return data;
+}
+
+// 一直读到对端关闭
+static inline std::string readUntilClose(int fd)
+{
+    std::string data;
+    char buf[64 * 1024];
+    for (;;)
+    {
+        ssize_t n = ::read(fd, buf, sizeof buf);
+        if (n <= 0)
+        {
+            break;
+        }
+        data.append(buf, n);
+    }
+    return data;
+}
+
+// 可重复验证的测试数据，seed不同内容不同
+static inline std::string makePayload(size_t len, int seed)
+{
+    std::string s(len, '\0');
+    for (size_t i = 0; i < len; ++i)
+    {
+        s[i] = static_cast<char>((i * 131 + seed * 7 + i / 4096) & 0xff);
+    }
+    return s;
+}
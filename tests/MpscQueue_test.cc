@@ -0,0 +1,70 @@
+// 多个生产者线程同时push，单个消费者consumeAll：不丢、不重，同一个生产者的元素保持先后顺序
+#include "MpscQueue.h"
+#include "Check.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+static const int kProducers = 4;
+static const int kPerProducer = 200000;
+
+struct Item
+{
+    int producer;
+    int seq;
+};
+
+int main()
+{
+    MpscQueue<Item> queue;
+    std::atomic<int> ready(0);
+    std::vector<std::thread> producers;
+    for (int p = 0; p < kProducers; ++p)
+    {
+        producers.emplace_back([&queue, &ready, p] {
+            ++ready;
+            while (ready.load() < kProducers)
+            {
+            }
+            for (int i = 0; i < kPerProducer; ++i)
+            {
+                queue.push(Item{p, i});
+            }
+        });
+    }
+
+    std::vector<int> next(kProducers, 0);
+    long total = 0;
+    auto consume = [&](Item &item) {
+        CHECK(item.producer >= 0 && item.producer < kProducers);
+        CHECK(item.seq == next[item.producer]);
+        ++next[item.producer];
+        ++total;
+    };
+    while (total < static_cast<long>(kProducers) * kPerProducer)
+    {
+        queue.consumeAll(consume);
+    }
+    for (std::thread &t : producers)
+    {
+        t.join();
+    }
+
+    CHECK(queue.consumeAll(consume) == 0);
+    CHECK(queue.empty());
+    for (int p = 0; p < kProducers; ++p)
+    {
+        CHECK(next[p] == kPerProducer);
+    }
+
+    // 还没消费的元素在队列析构时释放
+    {
+        MpscQueue<std::vector<int>> pending;
+        for (int i = 0; i < 100; ++i)
+        {
+            pending.push(std::vector<int>(16, i));
+        }
+    }
+    return 0;
+}
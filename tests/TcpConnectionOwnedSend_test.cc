@@ -0,0 +1,105 @@
+// 从其他线程send：调用返回以后调用者的数据马上被覆盖/释放，对端收到的还是原来的内容
+// 移动进来的string、交换进来的Buffer、SharedPayload都不拷贝，由连接持有到发完；SharedPayload发完以后放掉引用
+#include "TcpServer.h"
+#include "EventLoop.h"
+#include "Logger.h"
+#include "Loopback.h"
+
+#include <future>
+#include <memory>
+#include <string>
+#include <thread>
+
+static const uint16_t kPort = 19014;
+static const size_t kLarge = 2 * 1024 * 1024; // 比套接字缓冲区大得多，发送时一定有剩下的
+static const int kDelayMs = 100; // 客户端先不读，调用者的数据都已经没了才开始收
+
+int main()
+{
+    Logger::setLogLevel(ERROR);
+
+    const std::string copied = makePayload(kLarge, 1);
+    const std::string moved = makePayload(kLarge, 2);
+    const std::string swapped = makePayload(kLarge, 3);
+    const std::string shared = makePayload(kLarge, 4);
+    const std::string movedInLoop = makePayload(kLarge, 5);
+    const std::string expected = copied + moved + swapped + shared + movedInLoop;
+
+    EventLoop loop;
+    TcpServer server(&loop, InetAddress(kPort), "owned");
+    std::weak_ptr<const std::string> sharedWatcher;
+    bool sharedAliveAfterSend = false;
+    bool bufferEmptyAfterSend = false;
+    std::thread sender;
+    server.setConnectionCallback([&](const TcpConnectionPtr &conn) {
+        if (!conn->connected())
+        {
+            return;
+        }
+        sender = std::thread([&, conn] {
+            // 先让loop线程停在这里，等这个线程的数据全部覆盖/释放了再开始发，结果不依赖线程调度
+            std::promise<void> callerDone;
+            std::shared_future<void> done(callerDone.get_future());
+            conn->getLoop()->queueInLoop([done] { done.wait(); });
+
+            // 拷贝：调用返回以后马上覆盖再释放
+            std::string *temp = new std::string(copied);
+            conn->send(temp->data(), temp->size());
+            temp->assign(temp->size(), 'X');
+            delete temp;
+
+            // 移动：string在这个作用域结束时就析构了
+            {
+                std::string s(moved);
+                conn->send(std::move(s));
+            }
+
+            // 交换：调用以后Buffer是空的，再往里写也不影响已经交出去的数据
+            {
+                Buffer buf;
+                buf.append(swapped.data(), swapped.size());
+                conn->send(&buf);
+                bufferEmptyAfterSend = buf.readableBytes() == 0;
+                buf.append("garbage", 7);
+            }
+
+            // 共享：调用者放掉自己的引用，连接持有到发完
+            {
+                SharedPayload payload(std::make_shared<const std::string>(shared));
+                sharedWatcher = payload;
+                conn->send(payload);
+            }
+            sharedAliveAfterSend = !sharedWatcher.expired();
+
+            // loop线程里移动进来的大string同样直接引用；排在前面投递的数据后面
+            conn->getLoop()->runInLoop([conn, &movedInLoop] {
+                std::string s(movedInLoop);
+                conn->send(std::move(s));
+                conn->shutdown();
+            });
+            callerDone.set_value();
+        });
+    });
+    server.setMessageCallback([](const TcpConnectionPtr&, Buffer *buf, Timestamp) { buf->retrieveAll(); });
+    server.start();
+
+    std::string received;
+    std::thread client([&] {
+        int fd = connectLoopback(kPort, 4096);
+        ::usleep(kDelayMs * 1000);
+        received = readUntilClose(fd);
+        ::close(fd);
+        loop.quit();
+    });
+    loop.runAfter(30, [] { CHECK(!"timed out"); });
+    loop.loop();
+    client.join();
+    sender.join();
+
+    CHECK(received.size() == expected.size());
+    CHECK(received == expected);
+    CHECK(bufferEmptyAfterSend);
+    CHECK(sharedAliveAfterSend);
+    CHECK(sharedWatcher.expired()); // 发完以后连接放掉了对SharedPayload的引用
+    return 0;
+}
@@ -0,0 +1,97 @@
+// sendFile：文件内容和前后send的数据按顺序发出；调用返回以后调用者可以关掉自己的fd
+// 文件比登记的长度短时，发完文件现有的内容以后sendfile返回0，按EIO关闭连接，而不是一直等EPOLLOUT
+#include "TcpServer.h"
+#include "EventLoop.h"
+#include "Logger.h"
+#include "Loopback.h"
+
+#include <string>
+#include <thread>
+#include <fcntl.h>
+#include <stdlib.h>
+
+static const uint16_t kPort = 19015;
+static const size_t kFileSize = 3 * 1024 * 1024;
+static const size_t kMissing = 100 * 1024; // 短文件的情况下多登记的长度
+static const int kDelayMs = 50;
+
+// 建一个临时文件写入content，返回打开的fd（文件已经unlink）
+static int makeTempFile(const std::string &content)
+{
+    char path[] = "/tmp/sendfile_testXXXXXX";
+    int fd = ::mkstemp(path);
+    CHECK(fd >= 0);
+    ::unlink(path);
+    CHECK(::write(fd, content.data(), content.size()) == static_cast<ssize_t>(content.size()));
+    return fd;
+}
+
+// 边缘触发时handleWrite会一直写到EAGAIN，sendfile返回0要当成错误，否则会原地空转
+static void run(bool edgeTriggered, uint16_t port)
+{
+    const std::string content = makePayload(kFileSize, 15);
+    const std::string header = "HEADER\r\n";
+    const std::string trailer = "\r\nTRAILER";
+
+    EventLoop loop;
+    TcpServer server(&loop, InetAddress(port), "sendfile");
+    server.setEdgeTriggered(edgeTriggered);
+    int connections = 0;
+    int disconnected = 0;
+    server.setConnectionCallback([&](const TcpConnectionPtr &conn) {
+        if (!conn->connected())
+        {
+            ++disconnected;
+            return;
+        }
+        int fd = makeTempFile(content);
+        if (++connections == 1)
+        {
+            // 完整的文件加上一段偏移，前后都有普通数据
+            conn->send(header);
+            conn->sendFile(fd, 0, kFileSize);
+            conn->sendFile(fd, 1000, 5000);
+            conn->send(trailer);
+            conn->shutdown();
+        }
+        else
+        {
+            // 登记的长度超过了文件实际的长度
+            conn->sendFile(fd, 0, kFileSize + kMissing);
+        }
+        ::close(fd); // 连接自己dup了一份
+    });
+    server.setMessageCallback([](const TcpConnectionPtr&, Buffer *buf, Timestamp) { buf->retrieveAll(); });
+    server.start();
+
+    std::string whole, truncated;
+    std::thread client([&] {
+        int fd = connectLoopback(port, 4096);
+        ::usleep(kDelayMs * 1000); // 第一次sendfile写不完，剩下的挂进outputBuffer_
+        whole = readUntilClose(fd);
+        ::close(fd);
+
+        fd = connectLoopback(port, 4096);
+        ::usleep(kDelayMs * 1000);
+        truncated = readUntilClose(fd); // 服务端出错关闭连接，这里读到EOF
+        ::close(fd);
+        loop.runInLoop([&loop] { loop.quit(); });
+    });
+    loop.runAfter(30, [] { CHECK(!"timed out"); });
+    loop.loop();
+    client.join();
+
+    CHECK(whole == header + content + content.substr(1000, 5000) + trailer);
+    CHECK(truncated.size() == kFileSize);
+    CHECK(truncated == content);
+    CHECK(connections == 2);
+    CHECK(disconnected >= 1); // 短文件的连接是服务端主动关闭的，在client读到EOF之前就已经回调过
+}
+
+int main()
+{
+    Logger::setLogLevel(FATAL); // 短文件的情况会打错误日志
+    run(false, kPort);
+    run(true, kPort + 100);
+    return 0;
+}
@@ -0,0 +1,66 @@
+// send(std::vector<std::string>)：多段数据一次writev，段数超过kMaxIovec、对端收得慢写不完时，剩下的段按顺序挂进outputBuffer_
+#include "TcpServer.h"
+#include "EventLoop.h"
+#include "Logger.h"
+#include "Loopback.h"
+
+#include <string>
+#include <thread>
+#include <vector>
+
+static const uint16_t kPort = 19013;
+static const int kChunks = 100; // 超过ChainBuffer::kMaxIovec
+static const int kDelayMs = 100; // 客户端先不读，让第一次writev只写出一部分
+
+int main()
+{
+    Logger::setLogLevel(ERROR);
+
+    // 大大小小的段，有短于kMinRefBytes的（拷贝进slab），有大段（直接引用），还有一个空段
+    std::vector<std::string> chunks;
+    std::string expected;
+    for (int i = 0; i < kChunks; ++i)
+    {
+        size_t len = (i % 3 == 0) ? 100 + i : (i % 3 == 1) ? 20 * 1024 + i : 0;
+        if (i == kChunks / 2)
+        {
+            len = 4 * 1024 * 1024;
+        }
+        chunks.push_back(makePayload(len, i));
+        expected += chunks.back();
+    }
+
+    EventLoop loop;
+    TcpServer server(&loop, InetAddress(kPort), "writev");
+    size_t buffered = 0; // 第一次writev以后进了outputBuffer_的字节数
+    int writeCompletes = 0;
+    server.setConnectionCallback([&](const TcpConnectionPtr &conn) {
+        if (conn->connected())
+        {
+            conn->setHighWaterMarkCallback([&](const TcpConnectionPtr&, size_t len) { buffered = len; }, 1);
+            conn->send(std::move(chunks));
+            conn->shutdown(); // 发完才真正关闭写端
+        }
+    });
+    server.setMessageCallback([](const TcpConnectionPtr&, Buffer *buf, Timestamp) { buf->retrieveAll(); });
+    server.setWriteCompleteCallback([&](const TcpConnectionPtr&) { ++writeCompletes; });
+    server.start();
+
+    std::string received;
+    std::thread client([&] {
+        int fd = connectLoopback(kPort, 4096);
+        ::usleep(kDelayMs * 1000);
+        received = readUntilClose(fd);
+        ::close(fd);
+        loop.quit();
+    });
+    loop.runAfter(30, [] { CHECK(!"timed out"); });
+    loop.loop();
+    client.join();
+
+    CHECK(received.size() == expected.size());
+    CHECK(received == expected);
+    CHECK(buffered > 0 && buffered < expected.size()); // 走了部分写出、剩下的进outputBuffer_的路径
+    CHECK(writeCompletes == 1);
+    return 0;
+}
@@ -0,0 +1,99 @@
+// MSG_ZEROCOPY：大的引用数据用零拷贝发送，内核的完成通知从错误队列读走（reapZeroCopy）并计入ZeroCopyStats，
+// 读到通知以后才放掉数据的owner；回环上内核实际会拷贝，通知里带COPIED，记为fallbacks
+// 内核不支持SO_ZEROCOPY时setZeroCopy只打错误日志，照常发送，这时只检查数据
+#include "TcpServer.h"
+#include "EventLoop.h"
+#include "Logger.h"
+#include "Loopback.h"
+
+#include <memory>
+#include <string>
+#include <thread>
+
+#ifndef SO_ZEROCOPY
+#define SO_ZEROCOPY 60
+#endif
+
+static const uint16_t kPort = 19016;
+static const size_t kPayloadSize = 1024 * 1024;
+static const size_t kThreshold = 32 * 1024;
+static const int kSends = 4;
+
+static bool zeroCopySupported()
+{
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    int one = 1;
+    bool ok = ::setsockopt(fd, SOL_SOCKET, SO_ZEROCOPY, &one, sizeof one) == 0;
+    ::close(fd);
+    return ok;
+}
+
+int main()
+{
+    Logger::setLogLevel(FATAL);
+    const bool supported = zeroCopySupported();
+    if (!supported)
+    {
+        printf("SO_ZEROCOPY not supported by this kernel, only checking the data\n");
+    }
+
+    const std::string small = "small reply copied into a slab";
+    std::string expected;
+    std::weak_ptr<const std::string> watcher;
+
+    EventLoop loop;
+    TcpServer server(&loop, InetAddress(kPort), "zerocopy");
+    server.setZeroCopy(true, kThreshold);
+    TcpConnectionPtr connection; // 检查完之前不让连接销毁，owner只能是被完成通知放掉的
+    server.setConnectionCallback([&](const TcpConnectionPtr &conn) {
+        if (!conn->connected())
+        {
+            return;
+        }
+        connection = conn;
+        SharedPayload payload(std::make_shared<const std::string>(makePayload(kPayloadSize, 16)));
+        watcher = payload;
+        for (int i = 0; i < kSends; ++i)
+        {
+            conn->send(payload); // 同一份数据发几次，都引用它
+            conn->send(small); // 夹在中间的短数据还是拷贝
+            expected += *payload + small;
+        }
+    });
+    server.setMessageCallback([](const TcpConnectionPtr&, Buffer *buf, Timestamp) { buf->retrieveAll(); });
+    server.start();
+
+    std::string received;
+    std::thread client([&] {
+        int fd = connectLoopback(kPort, 4096);
+        received = readBytes(fd, kSends * (kPayloadSize + small.size()));
+        // 对端都收到了，等服务端处理完所有的完成通知再关
+        loop.runInLoop([&] {
+            loop.runEvery(0.01, [&] {
+                if (!supported || watcher.expired())
+                {
+                    loop.quit();
+                }
+            });
+        });
+        readUntilClose(fd);
+        ::close(fd);
+    });
+    loop.runAfter(30, [] { CHECK(!"timed out"); });
+    loop.loop();
+
+    CHECK(received == expected);
+    if (supported)
+    {
+        // 发完所有数据而且连接还在的时候，owner已经被完成通知放掉了
+        CHECK(watcher.expired());
+        CHECK(connection && connection->connected());
+        CHECK(server.zeroCopyHits() + server.zeroCopyFallbacks() > 0);
+    }
+    connection->shutdown();
+    connection.reset();
+    loop.runAfter(0.05, [&loop] { loop.quit(); });
+    loop.loop();
+    client.join();
+    return 0;
+}
@@ -0,0 +1,106 @@
+// ~TcpServer：loop已经退出以后在其他线程里析构，连接要在析构函数里同步销毁（断开回调执行、socket关闭），
+// 而不是投递给一个再也不会执行的loop；loop还在运行时投递过去，在loop线程里销毁
+#include "TcpServer.h"
+#include "EventLoop.h"
+#include "Logger.h"
+#include "Loopback.h"
+
+#include <atomic>
+#include <memory>
+#include <thread>
+
+static const uint16_t kPort = 19021;
+
+// mainloop已经退出，在另一个线程里析构server
+static void testDestroyAfterLoopExited()
+{
+    EventLoop loop;
+    std::unique_ptr<TcpServer> server(new TcpServer(&loop, InetAddress(kPort), "exited"));
+    std::atomic_int up(0), down(0);
+    server->setConnectionCallback([&](const TcpConnectionPtr &conn) {
+        if (conn->connected())
+        {
+            if (++up == 2)
+            {
+                loop.quit();
+            }
+        }
+        else
+        {
+            ++down;
+        }
+    });
+    server->setMessageCallback([](const TcpConnectionPtr&, Buffer *buf, Timestamp) { buf->retrieveAll(); });
+    server->start();
+
+    int fds[2];
+    std::thread client([&] {
+        fds[0] = connectLoopback(kPort);
+        fds[1] = connectLoopback(kPort);
+    });
+    loop.runAfter(10, [] { CHECK(!"timed out"); });
+    loop.loop();
+    client.join();
+    CHECK(up == 2 && down == 0);
+
+    std::thread destroyer([&] { server.reset(); });
+    destroyer.join();
+    CHECK(down == 2); // 析构函数返回时连接已经销毁了
+
+    for (int fd : fds)
+    {
+        CHECK(readUntilClose(fd).empty()); // 服务端的socket已经关闭，读到EOF
+        ::close(fd);
+    }
+}
+
+// subloop还在运行，在mainloop线程里析构：销毁投递到subloop线程执行，析构函数等它做完
+static void testDestroyWhileLooping()
+{
+    EventLoop loop;
+    std::unique_ptr<TcpServer> server(new TcpServer(&loop, InetAddress(kPort + 1), "looping"));
+    server->setThreadNum(1);
+    std::atomic_int up(0), down(0);
+    std::atomic_bool destroyedInLoopThread(false);
+    server->setConnectionCallback([&](const TcpConnectionPtr &conn) {
+        if (conn->connected())
+        {
+            ++up;
+        }
+        else
+        {
+            destroyedInLoopThread = conn->getLoop()->isInLoopThread();
+            ++down;
+        }
+    });
+    server->setMessageCallback([](const TcpConnectionPtr &conn, Buffer *buf, Timestamp) {
+        conn->send(buf->retrieveAllAsString());
+    });
+    server->start();
+
+    int fd = -1;
+    std::thread client([&] {
+        fd = connectLoopback(kPort + 1);
+        CHECK(::write(fd, "ping", 4) == 4);
+        CHECK(readBytes(fd, 4) == "ping");
+        loop.runInLoop([&loop] { loop.quit(); });
+    });
+    loop.runAfter(10, [] { CHECK(!"timed out"); });
+    loop.loop();
+    client.join();
+    CHECK(up == 1 && down == 0);
+
+    server.reset();
+    CHECK(down == 1);
+    CHECK(destroyedInLoopThread);
+    CHECK(readUntilClose(fd).empty());
+    ::close(fd);
+}
+
+int main()
+{
+    Logger::setLogLevel(ERROR);
+    testDestroyAfterLoopExited();
+    testDestroyWhileLooping();
+    return 0;
+}
@@ -0,0 +1,77 @@
+// 定时器按到期时间的先后执行，不早于设定的时间；cancel掉的不执行；周期定时器可以在自己的回调里cancel
+#include "EventLoop.h"
+#include "Timestamp.h"
+#include "TimerId.h"
+#include "Check.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+// 从start到现在过了多少秒
+static double elapsed(Timestamp start)
+{
+    return static_cast<double>(Timestamp::now().microSecondsSinceEpoch() - start.microSecondsSinceEpoch()) / 1000000.0;
+}
+
+int main()
+{
+    EventLoop loop;
+    const Timestamp start(Timestamp::now());
+
+    // 到期顺序和添加顺序无关
+    std::vector<int> order;
+    loop.runAfter(0.03, [&] { order.push_back(3); CHECK(elapsed(start) >= 0.03); });
+    loop.runAfter(0.01, [&] { order.push_back(1); CHECK(elapsed(start) >= 0.01); });
+    loop.runAfter(0.02, [&] { order.push_back(2); CHECK(elapsed(start) >= 0.02); });
+
+    bool cancelledFired = false;
+    TimerId cancelled = loop.runAfter(0.05, [&] { cancelledFired = true; });
+    loop.cancel(cancelled);
+
+    int ticks = 0;
+    TimerId every;
+    every = loop.runEvery(0.01, [&] {
+        if (++ticks == 5)
+        {
+            loop.cancel(every);
+        }
+    });
+
+    // 其他线程添加的定时器也在loop线程里执行
+    bool fromOtherThread = false;
+    std::thread other([&] {
+        loop.runAfter(0.04, [&] {
+            CHECK(loop.isInLoopThread());
+            fromOtherThread = true;
+        });
+    });
+    other.join();
+
+    // loop运行时其他线程不停添加马上到期的定时器，返回的TimerId要在定时器执行之前就构造好；
+    // cancel已经执行过的一次性定时器什么也不做
+    std::atomic<int> immediateFired(0);
+    const int kImmediate = 2000;
+    std::thread poster([&] {
+        for (int i = 0; i < kImmediate; ++i)
+        {
+            TimerId id = loop.runAfter(0, [&] { ++immediateFired; });
+            if (i % 2 == 0)
+            {
+                loop.cancel(id);
+            }
+        }
+    });
+
+    loop.runAfter(0.3, [&] { loop.quit(); });
+    loop.loop();
+    poster.join();
+
+    CHECK(order.size() == 3);
+    CHECK(order[0] == 1 && order[1] == 2 && order[2] == 3);
+    CHECK(!cancelledFired);
+    CHECK(ticks == 5);
+    CHECK(fromOtherThread);
+    CHECK(immediateFired >= kImmediate / 2 && immediateFired <= kImmediate);
+    return 0;
+}
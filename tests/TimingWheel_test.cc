@@ -0,0 +1,51 @@
+// 时间轮的超时：到时间才回调，touch会推迟超时，超过一圈的超时要多转几圈，remove以后不再回调
+#include "EventLoop.h"
+#include "TimingWheel.h"
+#include "Timestamp.h"
+#include "Check.h"
+
+static const double kTick = 0.02;
+static const size_t kSlots = 8; // 转一圈0.16秒
+
+static double elapsed(Timestamp start)
+{
+    return static_cast<double>(Timestamp::now().microSecondsSinceEpoch() - start.microSecondsSinceEpoch()) / 1000000.0;
+}
+
+int main()
+{
+    EventLoop loop;
+    loop.enableTimingWheel(kTick, kSlots);
+    TimingWheel *wheel = loop.timingWheel();
+    CHECK(wheel != nullptr);
+
+    // 条目在loop之后构造，先于时间轮析构
+    TimingWheel::Entry plain, touched, longer, removed;
+    int plainFired = 0, touchedFired = 0, longerFired = 0, removedFired = 0;
+    double plainAt = 0, touchedAt = 0, longerAt = 0;
+    const Timestamp start(Timestamp::now());
+
+    // 加进去的时候离下一次tick可能不到一个tick，所以实际超时最多提前一个tick
+    wheel->add(&plain, 0.06, [&] { ++plainFired; plainAt = elapsed(start); });
+    wheel->add(&touched, 0.06, [&] { ++touchedFired; touchedAt = elapsed(start); });
+    wheel->add(&longer, 0.3, [&] { ++longerFired; longerAt = elapsed(start); });
+    wheel->add(&removed, 0.06, [&] { ++removedFired; });
+
+    // touched一直活跃到0.2秒
+    TimerId toucher = loop.runEvery(kTick / 2, [&] { touched.touch(); });
+    loop.runAfter(0.2, [&] { loop.cancel(toucher); });
+    loop.runAfter(0.02, [&] { wheel->remove(&removed); });
+
+    loop.runAfter(0.6, [&] { loop.quit(); });
+    loop.loop();
+
+    CHECK(plainFired == 1);
+    CHECK(plainAt >= 0.06 - kTick);
+    CHECK(touchedFired == 1);
+    CHECK(touchedAt >= 0.2 + 0.06 - kTick);
+    CHECK(longerFired == 1);
+    CHECK(longerAt >= 0.3 - kTick);
+    CHECK(removedFired == 0);
+    CHECK(!plain.linked() && !touched.linked() && !longer.linked() && !removed.linked());
+    return 0;
+}